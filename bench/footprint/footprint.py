@@ -0,0 +1,484 @@
+#!/usr/bin/env python3
+"""
+Flash / SRAM footprint of the UNO firmware across the build flag matrix
+
+Builds every combination of DEBUG, _DEBUG, USE_MDNS and USE_DHCP with
+PlatformIO, then reports for each:
+
+  - flash (.text + .data) and SRAM (.data, .bss)
+  - worst-case stack depth, from a static call graph recovered from the
+    disassembly (frame sizes from function prologues, plus the deepest
+    interrupt handler on top)
+  - what is left of the 2K SRAM once all of the above are taken
+
+Results are compared against a stored baseline, which also records the
+configurations that did not build or fit, and the compiler the numbers came
+from. The exit status is 1 when a configuration stops building or fitting,
+or when a metric grows beyond the tolerance; a failure the baseline already
+has is reported, but expected.
+
+Usage:
+  footprint.py                     # Build, report, compare with baseline
+  footprint.py --update-baseline   # ... and store the results as baseline
+  footprint.py --verbose           # Also list the deepest call chains
+"""
+
+import argparse
+import bisect
+import itertools
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), "..", ".."))
+BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "baseline.json")
+
+PIO_ENV = "uno"
+
+# ATmega328P with the UNO bootloader
+FLASH_SIZE = 32256
+SRAM_SIZE = 2048
+
+# Bytes pushed by a call (return address) and by an interrupt (PC)
+RETURN_ADDRESS = 2
+
+# DEBUG implies _DEBUG, so there are three debug levels
+DEBUG_LEVELS = [[], ["_DEBUG"], ["DEBUG"]]
+OPTIONS = ["USE_MDNS", "USE_DHCP"]
+
+METRICS = ["flash", "data", "bss", "stack"]
+
+# Outcome of a build, as stored in the baseline
+OK = "ok"
+DOES_NOT_FIT = "does not fit"
+BUILD_FAILED = "build failed"
+
+
+def flag_matrix():
+    for debug in DEBUG_LEVELS:
+        for n in range(len(OPTIONS) + 1):
+            for options in itertools.combinations(OPTIONS, n):
+                yield debug + list(options)
+
+
+def config_name(flags):
+    return "+".join(flags) if flags else "(none)"
+
+
+def find_tool(name, toolchain):
+    candidates = []
+    if toolchain:
+        candidates.append(os.path.join(toolchain, name))
+    candidates.append(shutil.which(name))
+    candidates.append(os.path.expanduser(
+        os.path.join("~", ".platformio", "packages", "toolchain-atmelavr", "bin", name)))
+
+    for c in candidates:
+        if c and os.access(c, os.X_OK):
+            return c
+
+    sys.exit("E| {} not found, use --toolchain".format(name))
+
+
+def toolchain_version(size_tool):
+    """First line of avr-gcc --version, from the toolchain avr-size is in"""
+    gcc = os.path.join(os.path.dirname(size_tool), "avr-gcc")
+    try:
+        out = subprocess.check_output([gcc, "--version"], universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError):
+        return None
+    return out.splitlines()[0] if out else None
+
+
+def build(flags, build_dir):
+    """Build the firmware, returns (success, path to ELF or None, build output)
+
+    The ELF is returned even if the build failed: PlatformIO checks the size
+    after linking, so a firmware too large to upload is still there to be
+    analysed.
+    """
+    env = dict(os.environ)
+    env["PLATFORMIO_BUILD_FLAGS"] = " ".join("-D" + f for f in flags)
+    env["PLATFORMIO_BUILD_DIR"] = build_dir
+
+    # An ELF left by a former build must not pass for this one
+    elf = os.path.join(build_dir, PIO_ENV, "firmware.elf")
+    if os.path.exists(elf):
+        os.remove(elf)
+
+    p = subprocess.run(["pio", "run", "-e", PIO_ENV], cwd=ROOT, env=env,
+                       stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                       universal_newlines=True)
+
+    return p.returncode == 0, elf if os.path.exists(elf) else None, p.stdout
+
+
+# What PlatformIO (checkprogsize) and the linker report when it does not fit
+SIZE_ERRORS = [
+    (re.compile(r"The program size \((\d+) bytes\) is greater than maximum allowed \((\d+) bytes\)"),
+     "flash {} > {}"),
+    (re.compile(r"The data size \((\d+) bytes\) is greater than maximum allowed \((\d+) bytes\)"),
+     "data {} > {}"),
+    (re.compile(r"region [`']?text'? overflowed by (\d+) bytes"), "flash over by {}"),
+    (re.compile(r"region [`']?data'? overflowed by (\d+) bytes"), "SRAM over by {}"),
+]
+
+
+def build_errors(output):
+    """Size errors found in the build output"""
+    errors = []
+    for pattern, message in SIZE_ERRORS:
+        m = pattern.search(output)
+        if m:
+            errors.append(message.format(*m.groups()))
+    return errors
+
+
+def section_sizes(size_tool, elf):
+    out = subprocess.check_output([size_tool, "-A", elf], universal_newlines=True)
+    sizes = {}
+    for line in out.splitlines():
+        m = re.match(r"^\.(\w+)\s+(\d+)\s+\d+", line)
+        if m:
+            sizes[m.group(1)] = int(m.group(2))
+    return sizes
+
+
+# Disassembly parsing
+
+RE_FUNCTION = re.compile(r"^([0-9a-f]+) <(.+)>:$")
+RE_INSN = re.compile(r"^\s+([0-9a-f]+):\s+(?:[0-9a-f]{2} )+\s*(\S+)\s*([^;]*?)\s*(?:;\s*(.*))?$")
+RE_TARGET = re.compile(r"0x([0-9a-f]+)")
+
+
+class Function:
+    def __init__(self, name, addr):
+        self.name = name
+        self.addr = addr
+        self.insns = []         # (addr, mnemonic, operands, comment)
+        self.frame = 0          # Bytes of stack used by the function itself
+        self.calls = set()      # Functions called
+        self.tail_calls = set() # Functions jumped to
+        self.indirect = False   # Has icall / eicall
+
+
+def disassemble(objdump, elf):
+    out = subprocess.check_output([objdump, "-d", "-C", elf], universal_newlines=True)
+    functions = []
+    current = None
+
+    for line in out.splitlines():
+        m = RE_FUNCTION.match(line)
+        if m:
+            current = Function(m.group(2), int(m.group(1), 16))
+            functions.append(current)
+            continue
+
+        m = RE_INSN.match(line)
+        if m and current:
+            current.insns.append((int(m.group(1), 16), m.group(2), m.group(3), m.group(4) or ""))
+
+    functions.sort(key=lambda f: f.addr)
+    return functions
+
+
+def frame_size(f):
+    """Stack used by f: pushes, `rcall .+0` and the frame pointer adjustment"""
+    size = 0
+    fp = False
+
+    for i, (_, mnemonic, operands, _) in enumerate(f.insns):
+        if mnemonic == "push":
+            size += 1
+        elif mnemonic == "rcall" and operands == ".+0":
+            size += RETURN_ADDRESS
+        elif mnemonic == "in" and operands.replace(" ", "") == "r28,0x3d":
+            fp = True
+        elif fp and mnemonic == "sbiw" and operands.replace(" ", "").startswith("r28,"):
+            size += int(operands.split(",")[1], 0)
+            fp = False
+        elif fp and mnemonic == "subi" and operands.replace(" ", "").startswith("r28,"):
+            lo = int(operands.split(",")[1], 0)
+            hi = 0
+            if i + 1 < len(f.insns) and f.insns[i + 1][1] == "sbci":
+                hi = int(f.insns[i + 1][2].split(",")[1], 0)
+            value = hi << 8 | lo
+            # Only a subtraction allocates, large values are epilogues adding back
+            if value < 0x8000:
+                size += value
+            fp = False
+
+    return size
+
+
+def address_taken(functions, elf, objdump):
+    """Functions whose address is loaded into a register pair or stored in .data"""
+    starts = {f.addr: f for f in functions}
+    taken = set()
+
+    # ldi rN, lo8(pm(f)) / ldi rN+1, hi8(pm(f)); pointers are word addresses
+    for f in functions:
+        pending = {}
+        for _, mnemonic, operands, _ in f.insns:
+            if mnemonic != "ldi":
+                continue
+            reg, value = [x.strip() for x in operands.split(",")]
+            n = int(reg[1:])
+            pending[n] = int(value, 0)
+            if n - 1 in pending:
+                target = (pending[n] << 8 | pending[n - 1]) * 2
+                if target in starts:
+                    taken.add(starts[target])
+
+    # Vtables and initialized function pointers live in .data
+    out = subprocess.check_output([objdump, "-s", "-j", ".data", elf], universal_newlines=True)
+    data = bytearray()
+    for line in out.splitlines():
+        m = re.match(r"^\s*[0-9a-f]+ ((?:[0-9a-f]{2,8} ?){1,4})", line)
+        if m:
+            data += bytes.fromhex(m.group(1).replace(" ", ""))
+    for i in range(0, len(data) - 1):
+        target = (data[i + 1] << 8 | data[i]) * 2
+        if target in starts:
+            taken.add(starts[target])
+
+    # Zeroed words would otherwise point at the vector table
+    return {f for f in taken if f.addr and not f.name.startswith("__vector")}
+
+
+def call_graph(functions):
+    addrs = [f.addr for f in functions]
+
+    def containing(addr):
+        i = bisect.bisect_right(addrs, addr) - 1
+        return functions[i] if i >= 0 else None
+
+    for f in functions:
+        f.frame = frame_size(f)
+        for _, mnemonic, operands, comment in f.insns:
+            if mnemonic in ("icall", "eicall", "ijmp", "eijmp"):
+                f.indirect = True
+                continue
+            if mnemonic not in ("call", "rcall", "jmp", "rjmp"):
+                continue
+            if mnemonic == "rcall" and operands == ".+0":
+                continue
+
+            m = RE_TARGET.search(comment) or RE_TARGET.search(operands)
+            if not m:
+                continue
+            target = int(m.group(1), 16)
+            callee = containing(target)
+            if not callee or callee is f or callee.addr != target:
+                continue # Branch within the function
+
+            if mnemonic in ("call", "rcall"):
+                f.calls.add(callee)
+            else:
+                f.tail_calls.add(callee)
+
+
+def worst_stack(functions, taken):
+    """Worst-case stack depth of each function, with the chain reaching it"""
+    memo = {}
+    notes = set()
+    active = set()
+
+    # Indirect calls may reach any function whose address is taken
+    def depth(f):
+        if f in memo:
+            return memo[f]
+        if f in active:
+            notes.add("recursion through " + f.name + " ignored")
+            return (0, [])
+        active.add(f)
+
+        best = (0, [])
+        callees = [(c, RETURN_ADDRESS) for c in f.calls] + [(c, 0) for c in f.tail_calls]
+        if f.indirect:
+            callees += [(c, RETURN_ADDRESS) for c in taken]
+        for c, cost in callees:
+            d, chain = depth(c)
+            if d + cost > best[0]:
+                best = (d + cost, chain)
+
+        active.discard(f)
+        memo[f] = (f.frame + best[0], [f.name] + best[1])
+        return memo[f]
+
+    result = {f.name: depth(f) for f in functions}
+    return result, notes
+
+
+def analyse(elf, size_tool, objdump):
+    sizes = section_sizes(size_tool, elf)
+    functions = disassemble(objdump, elf)
+    call_graph(functions)
+    taken = address_taken(functions, elf, objdump)
+    depths, notes = worst_stack(functions, taken)
+
+    main = depths.get("main", (0, []))
+    isrs = [(d, chain) for name, (d, chain) in depths.items()
+            if name.startswith("__vector_") and name != "__vector_default"]
+    isr = max(isrs, key=lambda x: x[0]) if isrs else (0, [])
+
+    text = sizes.get("text", 0)
+    data = sizes.get("data", 0)
+    bss = sizes.get("bss", 0)
+    stack = main[0] + (isr[0] + RETURN_ADDRESS if isr[0] else 0)
+
+    return {
+        "flash": text + data,
+        "data": data,
+        "bss": bss,
+        "stack": stack,
+        "free": SRAM_SIZE - data - bss - stack,
+        "main_chain": main[1],
+        "isr_chain": isr[1],
+        "functions": {name: d for name, (d, _) in depths.items()},
+        "top": sorted(((d, name) for name, (d, _) in depths.items()), reverse=True)[:10],
+        "notes": sorted(notes),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="store the results as the new baseline")
+    parser.add_argument("--baseline", default=BASELINE,
+                        help="baseline file (default: %(default)s)")
+    parser.add_argument("--tolerance", type=int, default=0,
+                        help="bytes a metric may grow before it is a regression")
+    parser.add_argument("--toolchain", help="directory of avr-size and avr-objdump")
+    parser.add_argument("--json", help="also write the results to this file")
+    parser.add_argument("--verbose", action="store_true",
+                        help="show the deepest call chains")
+    args = parser.parse_args()
+
+    size_tool = find_tool("avr-size", args.toolchain)
+    objdump = find_tool("avr-objdump", args.toolchain)
+
+    toolchain = toolchain_version(size_tool)
+
+    # {"toolchain": avr-gcc version, "configs": {name: metrics or {"status": why not}}}
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            stored = json.load(f)
+        baseline = stored.get("configs", {})
+        if stored.get("toolchain") and stored["toolchain"] != toolchain:
+            print("W| Baseline is from {}, this is {}: numbers may differ for that alone\n".format(
+                stored["toolchain"], toolchain))
+
+    results = {}
+    regressions = []
+    failures = []
+
+    print("{:<30} {:>6} {:>5} {:>5} {:>6} {:>5}  {}".format(
+        "flags", "flash", "data", "bss", "stack", "free", "status"))
+
+    for flags in flag_matrix():
+        name = config_name(flags)
+        build_dir = os.path.join(ROOT, ".pio", "footprint", name.replace("+", "-").strip("()"))
+        ok, elf, output = build(flags, build_dir)
+        base = baseline.get(name)
+
+        problems = build_errors(output)
+        r = analyse(elf, size_tool, objdump) if elf else {}
+
+        if r and r["flash"] > FLASH_SIZE and not any(p.startswith("flash") for p in problems):
+            problems.append("flash over by {}".format(r["flash"] - FLASH_SIZE))
+        if r and r["free"] < 0:
+            problems.append("stack overflow by {}".format(-r["free"]))
+
+        # What is compared with the baseline is the kind of failure, the
+        # details change with every byte
+        if problems:
+            r["status"] = DOES_NOT_FIT
+        elif not ok:
+            r["status"] = BUILD_FAILED
+            problems.append(BUILD_FAILED)
+        else:
+            r["status"] = OK
+
+        if base is None:
+            against = "no baseline"
+        elif base.get("status", OK) != r["status"]:
+            against = "was: " + base.get("status", OK)
+            if r["status"] != OK:
+                failures.append((name, ", ".join(problems), base.get("status", OK)))
+        else:
+            against = "expected" if problems else ""
+
+        for metric in METRICS:
+            if r.get(metric) is not None and base and base.get(metric) is not None \
+                    and r[metric] > base[metric] + args.tolerance:
+                problems.append("{} +{}".format(metric, r[metric] - base[metric]))
+                regressions.append((name, metric, base[metric], r[metric]))
+
+        # A deeper function shows up here even if the total stays the same
+        grown = []
+        for fn, d in sorted(r.get("functions", {}).items()):
+            old = (base or {}).get("functions", {}).get(fn)
+            if old is not None and d > old + args.tolerance:
+                grown.append(fn)
+                regressions.append((name, "stack of " + fn, old, d))
+        if grown:
+            problems.append("deeper: " + ", ".join(grown[:3]) + (", ..." if len(grown) > 3 else ""))
+
+        status = ", ".join(problems) if problems else OK
+        if against:
+            status += " ({})".format(against)
+        results[name] = r
+
+        if "flash" in r:
+            print("{:<30} {:>6} {:>5} {:>5} {:>6} {:>5}  {}".format(
+                name, r["flash"], r["data"], r["bss"], r["stack"], r["free"], status))
+        else:
+            print("{:<30} {:>6} {:>5} {:>5} {:>6} {:>5}  {}".format(name, "-", "-", "-", "-", "-", status))
+
+        if args.verbose and "flash" in r:
+            print("    main: " + " -> ".join(r["main_chain"]))
+            if r["isr_chain"]:
+                print("    isr:  " + " -> ".join(r["isr_chain"]))
+            for d, fn in r["top"]:
+                print("    {:>5}  {}".format(d, fn))
+            for note in r["notes"]:
+                print("    note: " + note)
+
+    # A configuration dropped from the matrix is no longer watched
+    for name in sorted(set(baseline) - set(results)):
+        print("W| {} is in the baseline, but not built any more".format(name))
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+
+    if args.update_baseline:
+        # Failed configurations are kept, with why they failed
+        configs = {name: {k: r[k] for k in METRICS + ["functions", "status"] if k in r}
+                   for name, r in results.items()}
+        with open(args.baseline, "w") as f:
+            json.dump({"toolchain": toolchain, "configs": configs}, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("\nI| Baseline written to " + os.path.relpath(args.baseline, ROOT))
+        return 0
+
+    if failures:
+        print("\nE| Configurations that stopped building or fitting:")
+        for name, status, was in failures:
+            print("E|   {}: {} (was: {})".format(name, status, was))
+
+    if regressions:
+        print("\nW| Regressions against baseline:")
+        for name, metric, old, new in regressions:
+            print("W|   {}: {} {} -> {}".format(name, metric, old, new))
+
+    return 1 if failures or regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,85 @@
+#ifndef _ARDUINO_H
+#define _ARDUINO_H
+
+/**
+ * Just enough of the Arduino core to build the request path on a host
+ *
+ * Flash and SRAM are the same thing here, so PROGMEM vanishes and the _P
+ * functions are their plain libc counterparts.
+ */
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// avr/pgmspace.h
+#define PROGMEM
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr)      (*(const uint8_t *)(addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define pgm_read_word(addr)      (*(const uint16_t *)(addr))
+#define pgm_read_ptr(addr)       (*(const void *const *)(addr))
+
+#define memcpy_P      memcpy
+#define strcpy_P      strcpy
+#define strlen_P      strlen
+#define strcmp_P      strcmp
+#define strncmp_P     strncmp
+#define strcasecmp_P  strcasecmp
+#define strncasecmp_P strncasecmp
+#define sscanf_P      sscanf
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t strlcpy_P(char *dst, const char *src, size_t size);
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void yield(void);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define HIGH   0x1
+#define LOW    0x0
+#define INPUT  0x0
+#define OUTPUT 0x1
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#ifdef __cplusplus
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  operator bool() { return true; }
+
+  // Debug output goes to stderr, nothing ever comes in
+  int available(void) { return 0; }
+  int read(void) { return -1; }
+  int peek(void) { return -1; }
+  size_t write(uint8_t c) { return fputc(c, stderr) == EOF ? 0 : 1; }
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+#endif
+
+#endif /* end of include guard: _ARDUINO_H */
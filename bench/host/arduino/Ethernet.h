@@ -0,0 +1,7 @@
+#ifndef _ETHERNET_H
+#define _ETHERNET_H
+
+// Networking is done by hal-host.cpp, only the types hal.h names are here
+#include <Arduino.h>
+
+#endif /* end of include guard: _ETHERNET_H */
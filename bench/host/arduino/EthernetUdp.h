@@ -0,0 +1,9 @@
+#ifndef _ETHERNETUDP_H
+#define _ETHERNETUDP_H
+
+#include <Arduino.h>
+
+// mDNS is not part of host builds, the type only has to exist for hal.h
+class EthernetUDP {};
+
+#endif /* end of include guard: _ETHERNETUDP_H */
@@ -0,0 +1,32 @@
+#ifndef _IPADDRESS_H
+#define _IPADDRESS_H
+
+#include <stdint.h>
+
+#include "Print.h"
+
+class IPAddress : public Printable {
+public:
+  IPAddress() : _address{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address{a, b, c, d} {}
+  IPAddress(const uint8_t *address) : _address{address[0], address[1], address[2], address[3]} {}
+
+  uint8_t operator[](int index) const { return _address[index]; }
+  uint8_t & operator[](int index) { return _address[index]; }
+
+  size_t printTo(Print & p) const
+  {
+    size_t n = 0;
+    for (int i = 0; i < 4; i++) {
+      if (i)
+        n += p.print('.');
+      n += p.print(_address[i], DEC);
+    }
+    return n;
+  }
+
+private:
+  uint8_t _address[4];
+};
+
+#endif /* end of include guard: _IPADDRESS_H */
@@ -0,0 +1,43 @@
+#ifndef _PRINT_H
+#define _PRINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#include "Printable.h"
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+  size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+  virtual void flush(void) {}
+
+  size_t print(const __FlashStringHelper *str) { return write((const char *)str); }
+  size_t print(const char *str) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(const Printable & p) { return p.printTo(*this); }
+
+  template <typename T> size_t println(const T & x) { size_t n = print(x); return n + println(); }
+  template <typename T> size_t println(const T & x, int base) { size_t n = print(x, base); return n + println(); }
+  size_t println(void) { return write("\r\n"); }
+};
+
+#endif /* end of include guard: _PRINT_H */
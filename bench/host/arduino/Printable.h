@@ -0,0 +1,15 @@
+#ifndef _PRINTABLE_H
+#define _PRINTABLE_H
+
+#include <stddef.h>
+
+class Print;
+
+// Separate from Print.h as in the Arduino core, where libraries include it
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print & p) const = 0;
+};
+
+#endif /* end of include guard: _PRINTABLE_H */
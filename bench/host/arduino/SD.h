@@ -0,0 +1,33 @@
+#ifndef _SD_H
+#define _SD_H
+
+#include <Arduino.h>
+
+#define FILE_READ 0x01
+
+/**
+ * Read only file on the host file system
+ *
+ * Like the SD library, copies share the same open file, and nothing is
+ * closed behind the caller's back.
+ */
+class File : public Stream {
+public:
+  File() : _f(NULL), _size(0) {}
+  File(FILE *f);
+
+  operator bool() { return _f != NULL; }
+
+  int available(void);
+  int read(void);
+  int peek(void);
+  size_t write(uint8_t c) { (void)c; return 0; }
+  using Print::write;
+  void close(void);
+
+private:
+  FILE *_f;
+  long  _size;
+};
+
+#endif /* end of include guard: _SD_H */
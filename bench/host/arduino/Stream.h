@@ -0,0 +1,30 @@
+#ifndef _STREAM_H
+#define _STREAM_H
+
+#include "Print.h"
+
+class Stream : public Print {
+public:
+  Stream() : _timeout(1000), _startMillis(0) {}
+
+  virtual int available(void) = 0;
+  virtual int read(void) = 0;
+  virtual int peek(void) = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout(void) { return _timeout; }
+
+  // Both wait at most the timeout for each byte, as on the real thing
+  bool find(const char *target) { return find(target, strlen(target)); }
+  bool find(const char *target, size_t length);
+  size_t readBytes(char *buffer, size_t length);
+  size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+
+protected:
+  int timedRead(void);
+
+  unsigned long _timeout;
+  unsigned long _startMillis;
+};
+
+#endif /* end of include guard: _STREAM_H */
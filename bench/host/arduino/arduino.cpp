@@ -0,0 +1,210 @@
+#include <Arduino.h>
+#include <SD.h>
+
+#include <sched.h>
+#include <time.h>
+
+HardwareSerial Serial;
+
+static uint8_t pins[32];
+
+static unsigned long long now_us(void)
+{
+  static unsigned long long start = 0;
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  const unsigned long long us = (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+  if (!start)
+    start = us;
+
+  return us - start;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t strlcpy_P(char *dst, const char *src, size_t size)
+{
+  const size_t len = strlen(src);
+
+  if (size) {
+    const size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+
+  return len;
+}
+
+unsigned long millis(void)
+{
+  return now_us() / 1000;
+}
+
+unsigned long micros(void)
+{
+  return now_us();
+}
+
+void delay(unsigned long ms)
+{
+  struct timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000 };
+  nanosleep(&ts, NULL);
+}
+
+void yield(void)
+{
+  sched_yield();
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  if (pin < sizeof(pins))
+    pins[pin] = value;
+}
+
+int digitalRead(uint8_t pin)
+{
+  return pin < sizeof(pins) ? pins[pin] : LOW;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+// Print
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+
+  while (size--) {
+    if (!write(*buffer++))
+      break;
+    n++;
+  }
+
+  return n;
+}
+
+size_t Print::print(long n, int base)
+{
+  if (n < 0 && base == DEC)
+    return print('-') + print(0UL - (unsigned long)n, base);
+
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  char buffer[8 * sizeof(long) + 1];
+  char *p = buffer + sizeof(buffer) - 1;
+
+  if (base < 2)
+    base = DEC;
+
+  *p = '\0';
+  do {
+    const int digit = n % base;
+    *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    n /= base;
+  } while (n);
+
+  return write(p);
+}
+
+// Stream
+
+int Stream::timedRead(void)
+{
+  _startMillis = millis();
+
+  do {
+    const int c = read();
+    if (c >= 0)
+      return c;
+  } while (millis() - _startMillis < _timeout);
+
+  return -1;
+}
+
+bool Stream::find(const char *target, size_t length)
+{
+  size_t index = 0;
+  int c;
+
+  if (!length)
+    return true;
+
+  while ((c = timedRead()) >= 0) {
+    if (c == target[index]) {
+      if (++index == length)
+        return true;
+    } else {
+      index = c == target[0] ? 1 : 0;
+    }
+  }
+
+  return false;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+  size_t n = 0;
+
+  while (n < length) {
+    const int c = timedRead();
+    if (c < 0)
+      break;
+    buffer[n++] = (char)c;
+  }
+
+  return n;
+}
+
+// File
+
+File::File(FILE *f) : _f(f), _size(0)
+{
+  if (_f && fseek(_f, 0, SEEK_END) == 0) {
+    _size = ftell(_f);
+    rewind(_f);
+  }
+}
+
+int File::available(void)
+{
+  return _f ? (int)(_size - ftell(_f)) : 0;
+}
+
+int File::read(void)
+{
+  return _f ? fgetc(_f) : -1;
+}
+
+int File::peek(void)
+{
+  if (!_f)
+    return -1;
+
+  const int c = fgetc(_f);
+  if (c != EOF)
+    ungetc(c, _f);
+
+  return c;
+}
+
+void File::close(void)
+{
+  if (_f)
+    fclose(_f);
+  _f = NULL;
+}
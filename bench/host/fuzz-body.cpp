@@ -0,0 +1,35 @@
+/**
+ * Fuzz target for the JSON bodies, straight into the handlers parsing them
+ *
+ * The first byte picks the handler: even for PUT properties/on, odd for POST
+ * actions. The rest is the body.
+ */
+
+#include <Arduino.h>
+
+#include "thing-def.h"
+#include "hal.h"
+#include "thing-op.h"
+
+#include "memclient.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  if (!size)
+    return 0;
+
+  MemClient client(data + 1, size - 1);
+
+  if (data[0] & 1)
+    thing_proceed_actions(client, "POST", "/things/" THING_NAME "/actions");
+  else
+    thing_proceed_properties(client, "PUT", "/things/" THING_NAME "/properties/on");
+
+  if (!client.response_ok())
+    abort();
+
+  thing_reboot_pending = false;
+  hal_led_write(0);
+
+  return 0;
+}
@@ -0,0 +1,24 @@
+/**
+ * Fuzz target for a whole request: request line, headers and routing
+ *
+ * main.cpp is included so the static handle_request() is reachable.
+ */
+
+#include "../../src/main.cpp"
+
+#include "memclient.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  MemClient client(data, size);
+
+  handle_request(client);
+  if (!client.response_ok())
+    abort();
+
+  // The host never reboots, and starts each input from a known state
+  thing_reboot_pending = false;
+  hal_led_write(0);
+
+  return 0;
+}
@@ -0,0 +1,334 @@
+#include <Arduino.h>
+#include <SD.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "thing-def.h"
+#include "hal.h"
+#include "hal-host.h"
+
+/**
+ * Host backend, for the load harness and the fuzzers
+ *
+ * Behaves like the W5100 one as seen from the network: HAL_CLIENTS sockets
+ * (4 on the W5100), nothing listening while all of them are taken so new
+ * connections are refused, and requests served one at a time in socket
+ * order, from the first socket with something to read. As on the W5100,
+ * nothing waits for the request to be complete before the handler runs.
+ */
+
+#ifndef HAL_CLIENTS
+#define HAL_CLIENTS 4
+#endif
+
+#define BUFSIZE_FILE_PATH 512
+#define BUFSIZE_RX        256
+#define BUFSIZE_TX        256
+
+// How long hal_serve() sleeps waiting for the network
+#define HAL_POLL_MS 1
+
+#ifndef HOST_FILES
+#define HOST_FILES "files"
+#endif
+
+const char *hal_host_files = HOST_FILES;
+uint16_t    hal_host_port  = PORT;
+char      **hal_host_argv  = NULL;
+
+static int server = -1;
+static int sockets[HAL_CLIENTS];
+
+/**
+ * A connection, buffered both ways
+ */
+class HostClient : public Stream {
+public:
+  HostClient(int fd) : _fd(fd), _rx_pos(0), _rx_len(0), _tx_len(0) {}
+
+  int available(void)
+  {
+    int n = 0;
+
+    if (ioctl(_fd, FIONREAD, &n) < 0)
+      n = 0;
+
+    return (int)(_rx_len - _rx_pos) + n;
+  }
+
+  int read(void)
+  {
+    if (!fill())
+      return -1;
+
+    return _rx[_rx_pos++];
+  }
+
+  int peek(void)
+  {
+    if (!fill())
+      return -1;
+
+    return _rx[_rx_pos];
+  }
+
+  size_t write(uint8_t c)
+  {
+    if (_tx_len == BUFSIZE_TX)
+      flush();
+    if (_tx_len == BUFSIZE_TX)
+      return 0;
+
+    _tx[_tx_len++] = c;
+    return 1;
+  }
+
+  using Print::write;
+
+  void flush(void)
+  {
+    size_t sent = 0;
+
+    while (sent < _tx_len) {
+      const ssize_t n = send(_fd, _tx + sent, _tx_len - sent, MSG_NOSIGNAL);
+      if (n < 0 && errno == EAGAIN) {
+        struct pollfd p = { _fd, POLLOUT, 0 };
+        poll(&p, 1, (int)_timeout);
+        if (!(p.revents & POLLOUT))
+          break;
+        continue;
+      }
+      if (n <= 0)
+        break; // Peer is gone, drop the rest
+      sent += n;
+    }
+
+    _tx_len = 0;
+  }
+
+  // Like EthernetClient::stop(): disconnect, then wait up to the timeout for
+  // the peer to close too. Whatever it sends meanwhile is dropped, closing
+  // with unread data would make the kernel reset the connection.
+  void stop(void)
+  {
+    const unsigned long start = millis();
+    char discard[BUFSIZE_RX];
+
+    flush();
+    shutdown(_fd, SHUT_WR);
+
+    while (millis() - start < _timeout) {
+      struct pollfd p = { _fd, POLLIN, 0 };
+      if (poll(&p, 1, (int)(_timeout - (millis() - start))) <= 0)
+        break;
+      if (recv(_fd, discard, sizeof(discard), MSG_DONTWAIT) <= 0)
+        break;
+    }
+
+    close(_fd);
+  }
+
+private:
+  bool fill(void)
+  {
+    if (_rx_pos < _rx_len)
+      return true;
+
+    const ssize_t n = recv(_fd, _rx, sizeof(_rx), MSG_DONTWAIT);
+    if (n <= 0)
+      return false;
+
+    _rx_pos = 0;
+    _rx_len = n;
+    return true;
+  }
+
+  int     _fd;
+  uint8_t _rx[BUFSIZE_RX];
+  size_t  _rx_pos;
+  size_t  _rx_len;
+  uint8_t _tx[BUFSIZE_TX];
+  size_t  _tx_len;
+};
+
+static int free_socket(void)
+{
+  for (int i = 0; i < HAL_CLIENTS; i++)
+    if (sockets[i] < 0)
+      return i;
+
+  return -1;
+}
+
+static int listen_begin(void)
+{
+  struct sockaddr_in addr;
+  const int one = 1;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(hal_host_port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  server = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (server < 0 ||
+      setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+      bind(server, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(server, SOMAXCONN) < 0) {
+    perror("E| listen_begin");
+    if (server >= 0)
+      close(server);
+    server = -1;
+    return 0;
+  }
+
+  return 1;
+}
+
+// Take pending connections while there are free sockets, then stop listening
+// once there are none left, as the W5100 does
+static void accept_all(void)
+{
+  while (server >= 0) {
+    const int i = free_socket();
+
+    if (i < 0) {
+#ifdef DEBUG
+      Serial.println(F("W| No free socket, not listening"));
+#endif
+      close(server);
+      server = -1;
+      break;
+    }
+
+    const int fd = accept4(server, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+      break;
+
+    sockets[i] = fd;
+  }
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int hal_storage_begin(void)
+{
+  struct stat st;
+
+#ifdef DEBUG
+  Serial.print(F("I| Serving files from "));
+  Serial.println(hal_host_files);
+#endif
+
+  return stat(hal_host_files, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+hal_file_t hal_file_open_P(const char *path)
+{
+  char buffer[BUFSIZE_FILE_PATH];
+
+  snprintf(buffer, sizeof(buffer), "%s%s", hal_host_files, path);
+  return File(fopen(buffer, "rb"));
+}
+
+void hal_network_begin(void)
+{
+  for (int i = 0; i < HAL_CLIENTS; i++)
+    sockets[i] = -1;
+
+  if (!listen_begin())
+    exit(1);
+}
+
+void hal_network_maintain(void)
+{
+}
+
+IPAddress hal_local_ip(void)
+{
+  return IPAddress(127, 0, 0, 1);
+}
+
+void hal_serve(hal_handler_t handler)
+{
+  struct pollfd fds[1 + HAL_CLIENTS];
+
+  if (server < 0 && free_socket() >= 0)
+    listen_begin();
+
+  fds[0].fd = server;
+  fds[0].events = POLLIN;
+  for (int i = 0; i < HAL_CLIENTS; i++) {
+    fds[1 + i].fd = sockets[i];
+    fds[1 + i].events = POLLIN;
+  }
+
+  if (poll(fds, 1 + HAL_CLIENTS, HAL_POLL_MS) <= 0)
+    return;
+
+  accept_all();
+
+  for (int i = 0; i < HAL_CLIENTS; i++) {
+    if (sockets[i] < 0 || fds[1 + i].fd != sockets[i] || !fds[1 + i].revents)
+      continue;
+
+#ifdef DEBUG
+    Serial.println(F(">| New connection"));
+#endif
+
+    HostClient client(sockets[i]);
+    handler(client);
+
+#ifdef DEBUG
+    Serial.println(F("X| Closing connection"));
+#endif
+
+    client.stop();
+    sockets[i] = -1;
+    return;
+  }
+}
+
+int hal_udp_begin_multicast(hal_udp_t & udp, IPAddress group, uint16_t port)
+{
+  (void)udp;
+  (void)group;
+  (void)port;
+  return 0;
+}
+
+int hal_udp_begin_packet_multicast(hal_udp_t & udp, IPAddress group, uint16_t port)
+{
+  (void)udp;
+  (void)group;
+  (void)port;
+  return 0;
+}
+
+void hal_reboot(void)
+{
+#ifdef _DEBUG
+  Serial.println(F("I| Rebooting..."));
+#endif
+
+  if (!hal_host_argv)
+    abort();
+
+  // Start over, sockets are closed on exec
+  execv("/proc/self/exe", hal_host_argv);
+  perror("E| hal_reboot");
+  exit(1);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,22 @@
+#ifndef _HAL_HOST_H
+#define _HAL_HOST_H
+
+#include <stdint.h>
+
+/**
+ * Settings of the host backend, set by the program before setup()
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const char *hal_host_files; // Directory standing in for the SD card
+extern uint16_t    hal_host_port;  // TCP port on 127.0.0.1
+extern char      **hal_host_argv;  // For hal_reboot(), NULL if not supported
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: _HAL_HOST_H */
@@ -0,0 +1,43 @@
+/**
+ * Host build of the firmware, serving on 127.0.0.1
+ *
+ * Usage: host [-p port] [-f files directory] [-c]
+ *
+ * -c prints what the build was configured with (THING_NAME and the request
+ * buffer sizes, which the load harness needs) and exits. main.cpp is
+ * included for them, as they are private to it.
+ */
+
+#include "../../src/main.cpp"
+
+#include <unistd.h>
+
+#include "hal-host.h"
+
+int main(int argc, char *argv[])
+{
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:f:c")) != -1) {
+    switch (opt) {
+      case 'p':
+        hal_host_port = atoi(optarg);
+        break;
+      case 'f':
+        hal_host_files = optarg;
+        break;
+      case 'c':
+        printf("THING_NAME=%s\nBUFSIZE_PATH=%d\nBUFSIZE_LINE=%d\n", THING_NAME, BUFSIZE_PATH, BUFSIZE_LINE);
+        return 0;
+      default:
+        fprintf(stderr, "Usage: %s [-p port] [-f files directory] [-c]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  hal_host_argv = argv;
+
+  setup();
+  for (;;)
+    loop();
+}
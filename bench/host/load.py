@@ -0,0 +1,398 @@
+#!/usr/bin/env python3
+"""
+HTTP load and replay harness for the host build of the firmware
+
+Scenarios, each followed by a liveness check (GET / must still answer 200):
+
+  burst     the gateway opening many connections at once
+  pollers   several clients polling a property at the same time
+  pipeline  several requests written on one connection in one go
+  split     requests arriving in several segments
+  longpath  paths and request lines beyond BUFSIZE_PATH and BUFSIZE_LINE
+
+For each it reports throughput, p50/p99 latency, the error rate, and how many
+connections were reset for lack of a free socket (slot exhaustion). What a
+4-socket server answering one request per connection does by design is
+counted apart, as expected: refused connections in burst, and all but the
+first request in pipeline. The exit status is 1 if the server died or
+stopped answering, or if an error rate is above --max-error-rate (0).
+
+The thing name and the request buffer sizes of the build are asked from the
+server with --server (host -c), or given with --thing-name, --bufsize-path
+and --bufsize-line; they default to those of an unconfigured build.
+
+Usage:
+  load.py --server ./host             # Start the host server, run everything
+  load.py --port 8080 burst pollers   # Against a server already running
+"""
+
+import argparse
+import asyncio
+import json
+import math
+import re
+import socket
+import subprocess
+import sys
+import time
+
+# Of a build without THING_NAME given, see src/thing-def.h and src/main.cpp
+CONFIG_DEFAULTS = {"THING_NAME": "wot", "BUFSIZE_PATH": 75, "BUFSIZE_LINE": 81}
+
+RE_STATUS = re.compile(rb"^HTTP/1\.1 (\d{3})", re.M)
+
+# Outcomes of a request
+OK = "ok"
+NO_SLOT = "no slot"         # Reset before anything came back
+TIMEOUT = "timeout"
+CONNECT = "connect failed"
+NO_RESPONSE = "no response" # Closed without a status line
+UNANSWERED = "unanswered"   # Pipelined request left without response
+STATUS = "bad status"
+
+
+def headers(args):
+    return "Host: {}.local\r\nAccept: application/json\r\n".format(args.thing_name)
+
+
+def get(args, path):
+    return "GET {} HTTP/1.1\r\n{}\r\n".format(path, headers(args)).encode()
+
+
+def put_on(args, on):
+    body = json.dumps({"on": on}, separators=(",", ":"))
+    return ("PUT {}/properties/on HTTP/1.1\r\n{}Content-Type: application/json\r\n"
+            "Content-Length: {}\r\n\r\n{}".format(args.thing_path, headers(args), len(body), body)).encode()
+
+
+class Request:
+    def __init__(self, segments, expect, pipelined=1):
+        self.segments = segments   # Written in turn, with a delay in between
+        self.expect = expect       # Accepted status codes, one set per request
+        self.pipelined = pipelined # Number of requests in segments
+
+
+async def exchange(args, request):
+    """One connection, returns [(outcome, latency)] per request in it"""
+    loop = asyncio.get_event_loop()
+    start = loop.time()
+    data = b""
+
+    def result(outcome):
+        return [(outcome, None)] * request.pipelined
+
+    try:
+        reader, writer = await asyncio.wait_for(
+            asyncio.open_connection(args.host, args.port), args.timeout)
+    except (ConnectionRefusedError, ConnectionResetError):
+        return result(NO_SLOT)
+    except asyncio.TimeoutError:
+        return result(TIMEOUT)
+    except OSError:
+        return result(CONNECT)
+
+    try:
+        for i, segment in enumerate(request.segments):
+            if i:
+                await asyncio.sleep(args.split_delay)
+            writer.write(segment)
+            await writer.drain()
+
+        deadline = start + args.timeout
+        while True:
+            chunk = await asyncio.wait_for(reader.read(4096), max(0, deadline - loop.time()))
+            if not chunk:
+                break
+            data += chunk
+    except (ConnectionResetError, BrokenPipeError):
+        if not data:
+            return result(NO_SLOT)
+    except asyncio.TimeoutError:
+        return result(TIMEOUT)
+    finally:
+        writer.close()
+        try:
+            await writer.wait_closed()
+        except (ConnectionError, OSError):
+            pass
+
+    latency = loop.time() - start
+    statuses = [int(s) for s in RE_STATUS.findall(data)]
+    results = []
+
+    for i in range(request.pipelined):
+        if i >= len(statuses):
+            results.append((NO_RESPONSE if i == 0 else UNANSWERED, None))
+        elif statuses[i] not in request.expect:
+            results.append((STATUS, None))
+        else:
+            results.append((OK, latency))
+
+    return results
+
+
+async def sequential(args, requests):
+    results = []
+    for r in requests:
+        results += await exchange(args, r)
+    return results
+
+
+# Scenarios, each returns a list of (outcome, latency)
+
+async def burst(args):
+    results = []
+    for i in range(args.rounds):
+        if i:
+            await asyncio.sleep(args.burst_pause)
+        batch = await asyncio.gather(*[exchange(args, Request([get(args, args.thing_path)], {200}))
+                                       for _ in range(args.burst)])
+        results += [r for b in batch for r in b]
+    return results
+
+
+async def pollers(args):
+    loop = asyncio.get_event_loop()
+    end = loop.time() + args.duration
+
+    async def poller():
+        results = []
+        while loop.time() < end:
+            results += await exchange(args, Request([get(args, args.thing_path + "/properties/on")], {200}))
+        return results
+
+    batch = await asyncio.gather(*[poller() for _ in range(args.pollers)])
+    return [r for b in batch for r in b]
+
+
+async def pipeline(args):
+    pipelined = [get(args, args.thing_path + "/properties/on"), get(args, args.thing_path),
+                 get(args, "/things")]
+    request = Request([b"".join(pipelined)], {200}, pipelined=len(pipelined))
+    return await sequential(args, [request] * args.repeat)
+
+
+async def split(args):
+    line = get(args, args.thing_path + "/properties/on")
+    body = put_on(args, True)
+    header_end = body.index(b"\r\n\r\n") + 4
+
+    requests = [
+        # Request line cut in the middle
+        Request([line[:12], line[12:]], {200}),
+        # Headers one segment each
+        Request([s + b"\r\n" for s in line.split(b"\r\n")[:-1]], {200}),
+        # Header and body apart, then the body in two
+        Request([body[:header_end], body[header_end:]], {200}),
+        Request([body[:header_end], body[header_end:header_end + 6], body[header_end + 6:]], {200}),
+    ]
+    return await sequential(args, requests * args.repeat)
+
+
+async def longpath(args):
+    requests = []
+
+    # Unknown paths around and well beyond BUFSIZE_PATH
+    path, line = args.bufsize_path, args.bufsize_line
+    for n in (path - 2, path - 1, path, path + 1, line, 2 * line, 1024, 4096):
+        requests.append(Request([get(args, "/" + "a" * (n - 1))], {404}))
+
+    # A known prefix, truncated somewhere in what follows
+    prefix = args.thing_path + "/properties/on"
+    for n in (path, path + 1, 1024):
+        requests.append(Request([get(args, prefix + "/" + "x" * (n - len(prefix) - 1))], {404}))
+
+    # Short path, but a request line longer than BUFSIZE_LINE
+    requests.append(Request([("GET " + args.thing_path + " HTTP/1.1" + " " * line +
+                              "\r\n" + headers(args) + "\r\n").encode()], {200}))
+
+    return await sequential(args, requests * args.repeat)
+
+
+# Scenarios, with the outcomes they lead to by design
+SCENARIOS = {
+    "burst": (burst, {NO_SLOT}),
+    "pollers": (pollers, set()),
+    "pipeline": (pipeline, {UNANSWERED}),
+    "split": (split, set()),
+    "longpath": (longpath, set()),
+}
+
+
+def percentile(values, q):
+    if not values:
+        return None
+    values = sorted(values)
+    return values[max(0, math.ceil(q * len(values)) - 1)]
+
+
+def summarize(name, results, elapsed, expected):
+    latencies = [l for outcome, l in results if outcome == OK]
+    outcomes = {}
+    for outcome, _ in results:
+        outcomes[outcome] = outcomes.get(outcome, 0) + 1
+
+    requests = len(results)
+    ok = outcomes.get(OK, 0)
+    by_design = sum(count for outcome, count in outcomes.items() if outcome in expected)
+    errors = requests - ok - by_design
+    p50 = percentile(latencies, 0.50)
+    p99 = percentile(latencies, 0.99)
+    return {
+        "scenario": name,
+        "requests": requests,
+        "ok": ok,
+        "expected": by_design,
+        "errors": errors,
+        "error_rate": errors / requests if requests else 0.0,
+        "no_slot": outcomes.get(NO_SLOT, 0),
+        "outcomes": outcomes,
+        "throughput": ok / elapsed if elapsed else 0.0,
+        "p50_ms": None if p50 is None else p50 * 1000,
+        "p99_ms": None if p99 is None else p99 * 1000,
+    }
+
+
+def ms(value):
+    return "-" if value is None else "{:.1f}".format(value)
+
+
+async def alive(args):
+    results = await exchange(args, Request([get(args, "/")], {200}))
+    return results[0][0] == OK
+
+
+def start_server(args):
+    cmd = [args.server, "-p", str(args.port)]
+    if args.files:
+        cmd += ["-f", args.files]
+    proc = subprocess.Popen(cmd)
+
+    deadline = time.time() + 5
+    while time.time() < deadline:
+        if proc.poll() is not None:
+            sys.exit("E| {} exited with {}".format(args.server, proc.returncode))
+        # A full request, an empty connection would hold the server for the
+        # Stream timeout
+        try:
+            with socket.create_connection((args.host, args.port), 0.1) as s:
+                s.sendall(get(args, "/"))
+                while s.recv(4096):
+                    pass
+            return proc
+        except OSError:
+            time.sleep(0.05)
+
+    proc.kill()
+    sys.exit("E| {} is not listening on {}".format(args.server, args.port))
+
+
+def server_config(server):
+    """What the host build was configured with, see host -c"""
+    try:
+        out = subprocess.check_output([server, "-c"], universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit("E| cannot get the configuration of {}: {}".format(server, e))
+    return dict(line.split("=", 1) for line in out.splitlines() if "=" in line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("scenarios", nargs="*",
+                        help="scenarios to run: {} (default: all)".format(", ".join(SCENARIOS)))
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--server", help="start this host build first")
+    parser.add_argument("--files", help="files directory for --server")
+    parser.add_argument("--timeout", type=float, default=5.0,
+                        help="seconds a request may take (default: %(default)s)")
+    parser.add_argument("--burst", type=int, default=16,
+                        help="connections per burst (default: %(default)s)")
+    parser.add_argument("--rounds", type=int, default=5,
+                        help="bursts (default: %(default)s)")
+    parser.add_argument("--burst-pause", type=float, default=0.5,
+                        help="seconds between bursts (default: %(default)s)")
+    # One socket short of all 4: the connection a poller just closed may still
+    # hold its socket when the poller reconnects
+    parser.add_argument("--pollers", type=int, default=3,
+                        help="concurrent pollers (default: %(default)s)")
+    parser.add_argument("--duration", type=float, default=5.0,
+                        help="seconds of polling (default: %(default)s)")
+    parser.add_argument("--repeat", type=int, default=10,
+                        help="runs of the pipeline, split and longpath sets (default: %(default)s)")
+    parser.add_argument("--split-delay", type=float, default=0.05,
+                        help="seconds between segments (default: %(default)s)")
+    parser.add_argument("--thing-name", help="THING_NAME of the build (default: from --server)")
+    parser.add_argument("--bufsize-path", type=int, help="BUFSIZE_PATH of the build (default: from --server)")
+    parser.add_argument("--bufsize-line", type=int, help="BUFSIZE_LINE of the build (default: from --server)")
+    parser.add_argument("--max-error-rate", type=float, default=0.0,
+                        help="fail when a scenario has more errors than this (default: %(default)s)")
+    parser.add_argument("--json", help="also write the results to this file")
+    args = parser.parse_args()
+
+    names = args.scenarios or list(SCENARIOS)
+    for name in names:
+        if name not in SCENARIOS:
+            parser.error("unknown scenario: " + name)
+
+    config = dict(CONFIG_DEFAULTS)
+    if args.server:
+        config.update(server_config(args.server))
+    args.thing_name = args.thing_name or config["THING_NAME"]
+    args.bufsize_path = args.bufsize_path or int(config["BUFSIZE_PATH"])
+    args.bufsize_line = args.bufsize_line or int(config["BUFSIZE_LINE"])
+    args.thing_path = "/things/" + args.thing_name
+    print("I| THING_NAME {}, BUFSIZE_PATH {}, BUFSIZE_LINE {}\n".format(
+        args.thing_name, args.bufsize_path, args.bufsize_line))
+
+    proc = start_server(args) if args.server else None
+    loop = asyncio.get_event_loop()
+    summaries = []
+    failed = False
+
+    print("{:<10} {:>8} {:>6} {:>8} {:>7} {:>8} {:>8} {:>8} {:>8}".format(
+        "scenario", "requests", "ok", "expected", "errors", "no slot", "req/s", "p50 ms", "p99 ms"))
+
+    try:
+        for name in names:
+            start = time.time()
+            scenario, expected = SCENARIOS[name]
+            results = loop.run_until_complete(scenario(args))
+            s = summarize(name, results, time.time() - start, expected)
+            summaries.append(s)
+
+            print("{:<10} {:>8} {:>6} {:>8} {:>6.1f}% {:>8} {:>8.1f} {:>8} {:>8}".format(
+                name, s["requests"], s["ok"], s["expected"], s["error_rate"] * 100, s["no_slot"],
+                s["throughput"], ms(s["p50_ms"]), ms(s["p99_ms"])))
+            for outcome, count in sorted(s["outcomes"].items()):
+                if outcome != OK:
+                    print("{:>12} {}: {}{}".format("", outcome, count,
+                                                   " (expected)" if outcome in expected else ""))
+
+            if s["error_rate"] > args.max_error_rate:
+                print("E| {} has {:.1f}% errors, more than {:.1f}%".format(
+                    name, s["error_rate"] * 100, args.max_error_rate * 100))
+                failed = True
+
+            if proc and proc.poll() is not None:
+                print("E| server exited with {} during {}".format(proc.returncode, name))
+                failed = True
+                break
+            if not loop.run_until_complete(alive(args)):
+                print("E| server stopped answering after {}".format(name))
+                failed = True
+                break
+    finally:
+        if proc:
+            proc.terminate()
+            proc.wait()
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(summaries, f, indent=2)
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,48 @@
+#ifndef _MEMCLIENT_H
+#define _MEMCLIENT_H
+
+#include <Arduino.h>
+
+/**
+ * Connection reading a request from memory and keeping the response
+ *
+ * The timeout is zero: running out of input is the end of the request,
+ * there is nothing more to wait for.
+ */
+class MemClient : public Stream {
+public:
+  MemClient(const uint8_t *data, size_t size) : _data(data), _size(size), _pos(0), _out_len(0)
+  {
+    setTimeout(0);
+  }
+
+  int available(void) { return (int)(_size - _pos); }
+  int read(void) { return _pos < _size ? _data[_pos++] : -1; }
+  int peek(void) { return _pos < _size ? _data[_pos] : -1; }
+
+  size_t write(uint8_t c)
+  {
+    if (_out_len < sizeof(_out))
+      _out[_out_len] = c;
+    _out_len++;
+    return 1;
+  }
+
+  using Print::write;
+
+  // Anything sent back must at least start with a status line
+  bool response_ok(void) const
+  {
+    static const char status[] = "HTTP/1.1 ";
+    return _out_len == 0 || (_out_len >= sizeof(status) - 1 && memcmp(_out, status, sizeof(status) - 1) == 0);
+  }
+
+private:
+  const uint8_t *_data;
+  size_t         _size;
+  size_t         _pos;
+  uint8_t        _out[64];
+  size_t         _out_len;
+};
+
+#endif /* end of include guard: _MEMCLIENT_H */
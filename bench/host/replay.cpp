@@ -0,0 +1,85 @@
+/**
+ * Runs a fuzz target over files, for crash reproduction and corpus
+ * regression runs without libFuzzer
+ *
+ * Usage: replay-<target> <file or directory>...
+ */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static int replay_file(const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  uint8_t *data = NULL;
+  size_t size = 0;
+  uint8_t buffer[4096];
+  size_t n;
+
+  if (!f) {
+    perror(path);
+    return 0;
+  }
+
+  while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+    data = (uint8_t *)realloc(data, size + n);
+    memcpy(data + size, buffer, n);
+    size += n;
+  }
+  fclose(f);
+
+  LLVMFuzzerTestOneInput(data, size);
+  free(data);
+
+  return 1;
+}
+
+static int replay(const char *path)
+{
+  struct stat st;
+  int count = 0;
+
+  if (stat(path, &st) != 0) {
+    perror(path);
+    return 0;
+  }
+
+  if (!S_ISDIR(st.st_mode))
+    return replay_file(path);
+
+  DIR *d = opendir(path);
+  struct dirent *de;
+  while (d && (de = readdir(d))) {
+    char child[1024];
+    if (de->d_name[0] == '.')
+      continue;
+    snprintf(child, sizeof(child), "%s/%s", path, de->d_name);
+    count += replay(child);
+  }
+  if (d)
+    closedir(d);
+
+  return count;
+}
+
+int main(int argc, char *argv[])
+{
+  int count = 0;
+
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <file or directory>...\n", argv[0]);
+    return 2;
+  }
+
+  for (int i = 1; i < argc; i++)
+    count += replay(argv[i]);
+
+  printf("%d input(s) replayed\n", count);
+  return 0;
+}
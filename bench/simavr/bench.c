@@ -0,0 +1,345 @@
+/**
+ * Cycle counting benchmark of the UNO firmware under simavr
+ *
+ * Runs the real firmware.elf on a simulated ATmega328P, with a W5100 and an
+ * SD card (holding files/) on the SPI bus, injects one request per route and
+ * reports CPU cycles from injection to the firmware closing the connection,
+ * plus stack and SRAM use.
+ *
+ * Usage: bench <firmware.elf> <files directory>
+ */
+
+#include <fcntl.h>
+#include <gelf.h>
+#include <libelf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_irq.h"
+#include "avr_ioport.h"
+#include "avr_spi.h"
+
+#include "sdcard.h"
+#include "w5100.h"
+
+#ifndef THING_NAME
+#define THING_NAME "wot"
+#endif
+
+#ifndef PORT
+#define PORT 80
+#endif
+
+#define F_CPU       16000000UL
+#define RAMSTART    0x0100
+#define STACK_PAINT 0xa5
+
+// Give up on a request (or on booting) after this many simulated seconds
+#define TIMEOUT_S   10
+
+// Ethernet shield wiring: W5100 SS on D10 (PB2), SD SS on D4 (PD4)
+#define W5100_SS_PORT 'B'
+#define W5100_SS_PIN  2
+#define SD_SS_PORT    'D'
+#define SD_SS_PIN     4
+
+#define HTTP_HEADERS "Host: " THING_NAME ".local\r\nAccept: application/json\r\n"
+#define THING_PATH   "/things/" THING_NAME
+
+struct route {
+  const char *name;
+  const char *request;
+};
+
+// NOTE: The reboot action goes last, for obvious reasons
+static const struct route routes[] = {
+  { "GET /",
+    "GET / HTTP/1.1\r\n" HTTP_HEADERS "\r\n" },
+  { "GET /things",
+    "GET /things HTTP/1.1\r\n" HTTP_HEADERS "\r\n" },
+  { "GET " THING_PATH,
+    "GET " THING_PATH " HTTP/1.1\r\n" HTTP_HEADERS "\r\n" },
+  { "GET " THING_PATH "/properties/on",
+    "GET " THING_PATH "/properties/on HTTP/1.1\r\n" HTTP_HEADERS "\r\n" },
+  { "PUT " THING_PATH "/properties/on",
+    "PUT " THING_PATH "/properties/on HTTP/1.1\r\n" HTTP_HEADERS
+    "Content-Type: application/json\r\nContent-Length: 11\r\n\r\n{\"on\":true}" },
+  { "POST " THING_PATH "/actions",
+    "POST " THING_PATH "/actions HTTP/1.1\r\n" HTTP_HEADERS
+    "Content-Type: application/json\r\nContent-Length: 17\r\n\r\n{\"name\":\"reboot\"}" },
+};
+
+#define ROUTES (sizeof(routes) / sizeof(routes[0]))
+
+// Addresses of interesting symbols in SRAM, 0 if not found
+struct symbols {
+  uint16_t data_start;
+  uint16_t heap_start;
+  uint16_t brkval;
+};
+
+static struct w5100 w5100;
+static struct sdcard sdcard;
+
+static void spi_output(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+  (void)irq;
+  avr_irq_t *spi_input = param;
+  uint8_t miso = 0xff;
+
+  if (w5100.selected)
+    miso = w5100_spi(&w5100, value);
+  else if (sdcard.selected)
+    miso = sdcard_spi(&sdcard, value);
+
+  avr_raise_irq(spi_input, miso);
+}
+
+// Chip selects are active low
+static void w5100_ss(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+  (void)irq;
+  (void)param;
+  w5100_select(&w5100, !value);
+}
+
+static void sd_ss(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+  (void)irq;
+  (void)param;
+  sdcard_select(&sdcard, !value);
+}
+
+static int symbols_read(const char *path, struct symbols *syms)
+{
+  int fd = open(path, O_RDONLY);
+  Elf *elf = NULL;
+  Elf_Scn *scn = NULL;
+
+  memset(syms, 0, sizeof(*syms));
+
+  if (fd < 0 || elf_version(EV_CURRENT) == EV_NONE || !(elf = elf_begin(fd, ELF_C_READ, NULL))) {
+    perror(path);
+    if (fd >= 0)
+      close(fd);
+    return 0;
+  }
+
+  while ((scn = elf_nextscn(elf, scn))) {
+    GElf_Shdr shdr;
+    if (!gelf_getshdr(scn, &shdr) || shdr.sh_type != SHT_SYMTAB)
+      continue;
+
+    Elf_Data *data = elf_getdata(scn, NULL);
+    for (size_t i = 0; data && i < shdr.sh_size / shdr.sh_entsize; i++) {
+      GElf_Sym sym;
+      if (!gelf_getsym(data, i, &sym))
+        continue;
+
+      // SRAM lives at 0x800000 in AVR ELF files
+      const char *name = elf_strptr(elf, shdr.sh_link, sym.st_name);
+      const uint16_t addr = sym.st_value & 0xffff;
+      if (!name)
+        continue;
+      if (strcmp(name, "__data_start") == 0)
+        syms->data_start = addr;
+      else if (strcmp(name, "__heap_start") == 0)
+        syms->heap_start = addr;
+      else if (strcmp(name, "__brkval") == 0)
+        syms->brkval = addr;
+    }
+  }
+
+  elf_end(elf);
+  close(fd);
+
+  if (!syms->heap_start) {
+    fprintf(stderr, "E| %s: __heap_start not found\n", path);
+    return 0;
+  }
+  if (!syms->data_start)
+    syms->data_start = RAMSTART;
+
+  return 1;
+}
+
+static uint16_t sp_get(avr_t *avr)
+{
+  return avr->data[R_SPL] | avr->data[R_SPH] << 8;
+}
+
+// Top of the heap, as far as malloc() is concerned
+static uint16_t heap_top(avr_t *avr, const struct symbols *syms)
+{
+  uint16_t brk = 0;
+
+  if (syms->brkval)
+    brk = avr->data[syms->brkval] | avr->data[syms->brkval + 1] << 8;
+
+  return brk > syms->heap_start ? brk : syms->heap_start;
+}
+
+// Fill the unused part of SRAM between heap and stack with a pattern
+static void stack_paint(avr_t *avr, const struct symbols *syms)
+{
+  const uint16_t sp = sp_get(avr);
+
+  for (uint16_t addr = heap_top(avr, syms); addr < sp; addr++)
+    avr->data[addr] = STACK_PAINT;
+}
+
+// Lowest address the stack has reached since stack_paint()
+static uint16_t stack_low(avr_t *avr, const struct symbols *syms)
+{
+  uint16_t addr = heap_top(avr, syms);
+
+  while (addr < avr->ramend && avr->data[addr] == STACK_PAINT)
+    addr++;
+
+  return addr;
+}
+
+static int run_until_listening(avr_t *avr)
+{
+  const avr_cycle_count_t deadline = avr->cycle + TIMEOUT_S * F_CPU;
+  int s = -1;
+
+  while ((s = w5100_listening(&w5100, PORT)) < 0 && avr->cycle < deadline) {
+    const int state = avr_run(avr);
+    if (state == cpu_Done || state == cpu_Crashed)
+      return -1;
+  }
+
+  return s;
+}
+
+static int run_until_closed(avr_t *avr, int s)
+{
+  const avr_cycle_count_t deadline = avr->cycle + TIMEOUT_S * F_CPU;
+
+  while (!w5100.sock[s].closed && avr->cycle < deadline) {
+    const int state = avr_run(avr);
+    if (state == cpu_Done || state == cpu_Crashed)
+      return 0;
+  }
+
+  return w5100.sock[s].closed;
+}
+
+// First line of the response, for the report
+static void status_line(const struct w5100_socket *sock, char *buf, size_t size)
+{
+  size_t n = 0;
+
+  while (n < sock->out_len && n < size - 1 && sock->out[n] != '\r' && sock->out[n] != '\n') {
+    buf[n] = sock->out[n];
+    n++;
+  }
+  buf[n] = '\0';
+
+  if (!n)
+    snprintf(buf, size, "(no response)");
+}
+
+int main(int argc, char *argv[])
+{
+  elf_firmware_t firmware;
+  struct symbols syms;
+  uint16_t stack_peak = 0;
+  int failed = 0;
+
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <firmware.elf> <files directory>\n", argv[0]);
+    return 2;
+  }
+
+  if (!symbols_read(argv[1], &syms))
+    return 1;
+
+  memset(&firmware, 0, sizeof(firmware));
+  if (elf_read_firmware(argv[1], &firmware) != 0) {
+    fprintf(stderr, "E| %s: cannot load firmware\n", argv[1]);
+    return 1;
+  }
+
+  // Arduino builds carry no simavr MCU section
+  strcpy(firmware.mmcu, "atmega328p");
+  firmware.frequency = F_CPU;
+
+  avr_t *avr = avr_make_mcu_by_name(firmware.mmcu);
+  if (!avr) {
+    fprintf(stderr, "E| %s: unknown MCU\n", firmware.mmcu);
+    return 1;
+  }
+  avr_init(avr);
+  avr_load_firmware(avr, &firmware);
+
+  w5100_init(&w5100);
+  if (!sdcard_init(&sdcard, argv[2])) {
+    fprintf(stderr, "E| %s: cannot build SD card image\n", argv[2]);
+    return 1;
+  }
+
+  // Wire the SPI bus and chip selects
+  avr_irq_t *spi_input = avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_INPUT);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT), spi_output, spi_input);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(W5100_SS_PORT), W5100_SS_PIN), w5100_ss, NULL);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(SD_SS_PORT), SD_SS_PIN), sd_ss, NULL);
+
+  // Boot until the server is listening
+  const avr_cycle_count_t boot = avr->cycle;
+  if (run_until_listening(avr) < 0) {
+    fprintf(stderr, "E| firmware never started listening on port %d\n", PORT);
+    return 1;
+  }
+
+  const unsigned static_sram = syms.heap_start - syms.data_start;
+
+  printf("firmware:    %s\n", argv[1]);
+  printf("boot:        %llu cycles\n", (unsigned long long)(avr->cycle - boot));
+  printf("data + bss:  %u bytes\n\n", static_sram);
+  printf("%-32s %-28s %10s %9s %6s\n", "route", "status", "cycles", "us", "stack");
+
+  for (size_t i = 0; i < ROUTES; i++) {
+    char status[29];
+    const int s = run_until_listening(avr);
+    if (s < 0) {
+      fprintf(stderr, "E| %s: firmware stopped listening\n", routes[i].name);
+      failed = 1;
+      break;
+    }
+
+    stack_paint(avr, &syms);
+
+    const avr_cycle_count_t start = avr->cycle;
+    w5100_inject(&w5100, s, routes[i].request, strlen(routes[i].request));
+    const int closed = run_until_closed(avr, s);
+    const avr_cycle_count_t cycles = avr->cycle - start;
+
+    const uint16_t stack = avr->ramend + 1 - stack_low(avr, &syms);
+    if (stack > stack_peak)
+      stack_peak = stack;
+
+    status_line(&w5100.sock[s], status, sizeof(status));
+    if (!closed) {
+      snprintf(status, sizeof(status), "(timeout)");
+      failed = 1;
+    }
+
+    printf("%-32s %-28s %10llu %9llu %6u\n", routes[i].name, status,
+           (unsigned long long)cycles, (unsigned long long)(cycles * 1000000 / F_CPU), stack);
+  }
+
+  const unsigned heap = heap_top(avr, &syms) - syms.heap_start;
+  const unsigned sram = avr->ramend + 1 - RAMSTART;
+
+  printf("\npeak SRAM:   %u / %u bytes (data + bss %u, heap %u, stack %u)\n",
+         static_sram + heap + stack_peak, sram, static_sram, heap, stack_peak);
+
+  sdcard_free(&sdcard);
+  return failed;
+}
@@ -0,0 +1,357 @@
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "sdcard.h"
+
+#define SECTOR        512
+#define RESERVED      1
+#define FATS          2
+#define FAT_SECTORS   32
+#define ROOT_ENTRIES  512
+#define ROOT_SECTORS  (ROOT_ENTRIES * 32 / SECTOR)
+#define FAT_START     RESERVED
+#define ROOT_START    (FAT_START + FATS * FAT_SECTORS)
+#define DATA_START    (ROOT_START + ROOT_SECTORS)
+#define CLUSTERS      (SDCARD_SECTORS - DATA_START)
+
+#define ATTR_DIRECTORY 0x10
+#define ATTR_ARCHIVE   0x20
+
+// R1 response bits
+#define R1_READY   0x00
+#define R1_IDLE    0x01
+#define R1_ILLEGAL 0x04
+
+// Data start token
+#define TOKEN_START_BLOCK 0xfe
+
+struct fat16 {
+  uint8_t *image;
+  uint16_t next; // Next free cluster
+};
+
+static void put16(uint8_t *p, uint16_t v)
+{
+  p[0] = v & 0xff;
+  p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+  put16(p, v & 0xffff);
+  put16(p + 2, v >> 16);
+}
+
+static uint8_t *fat16_cluster(struct fat16 *fs, uint16_t cluster)
+{
+  return fs->image + (size_t)(DATA_START + cluster - 2) * SECTOR;
+}
+
+static void fat16_set(struct fat16 *fs, uint16_t cluster, uint16_t value)
+{
+  for (int i = 0; i < FATS; i++)
+    put16(fs->image + (size_t)(FAT_START + i * FAT_SECTORS) * SECTOR + cluster * 2, value);
+}
+
+// Allocate a contiguous cluster chain holding bytes, 0 if out of space
+static uint16_t fat16_alloc(struct fat16 *fs, size_t bytes)
+{
+  const size_t n = bytes ? (bytes + SECTOR - 1) / SECTOR : 1;
+  const uint16_t first = fs->next;
+
+  if (first + n > CLUSTERS + 2)
+    return 0;
+
+  for (size_t i = 0; i < n; i++)
+    fat16_set(fs, first + i, i == n - 1 ? 0xffff : first + i + 1);
+
+  fs->next += n;
+  return first;
+}
+
+// Convert a host file name to a padded 8.3 name, 0 if it does not fit
+static int fat16_name(const char *name, uint8_t out[11])
+{
+  const char *dot = strrchr(name, '.');
+  const size_t base = dot ? (size_t)(dot - name) : strlen(name);
+  const size_t ext = dot ? strlen(dot + 1) : 0;
+
+  if (base == 0 || base > 8 || ext > 3)
+    return 0;
+
+  memset(out, ' ', 11);
+  for (size_t i = 0; i < base; i++)
+    out[i] = toupper((unsigned char)name[i]);
+  for (size_t i = 0; i < ext; i++)
+    out[8 + i] = toupper((unsigned char)dot[1 + i]);
+
+  return 1;
+}
+
+static void fat16_dirent(uint8_t *e, const uint8_t name[11], uint8_t attr, uint16_t cluster, uint32_t size)
+{
+  memcpy(e, name, 11);
+  e[11] = attr;
+  put16(e + 26, cluster);
+  put32(e + 28, size);
+}
+
+static size_t fat16_count(const char *path)
+{
+  size_t n = 0;
+  DIR *d = opendir(path);
+  struct dirent *de;
+
+  if (!d)
+    return 0;
+  while ((de = readdir(d)))
+    if (de->d_name[0] != '.')
+      n++;
+  closedir(d);
+
+  return n;
+}
+
+static int fat16_dir(struct fat16 *fs, const char *path, uint8_t *entries, size_t max, uint16_t self, uint16_t parent)
+{
+  DIR *d = opendir(path);
+  struct dirent *de;
+  size_t n = 0;
+
+  if (!d) {
+    perror(path);
+    return 0;
+  }
+
+  if (self) {
+    static const uint8_t dot[11]    = {'.', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '};
+    static const uint8_t dotdot[11] = {'.', '.', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '};
+    fat16_dirent(entries + 32 * n++, dot, ATTR_DIRECTORY, self, 0);
+    fat16_dirent(entries + 32 * n++, dotdot, ATTR_DIRECTORY, parent, 0);
+  }
+
+  while ((de = readdir(d))) {
+    char child[1024];
+    uint8_t name[11];
+    struct stat st;
+
+    if (de->d_name[0] == '.')
+      continue;
+
+    if (!fat16_name(de->d_name, name)) {
+      fprintf(stderr, "W| %s/%s: not an 8.3 name, skipped\n", path, de->d_name);
+      continue;
+    }
+
+    snprintf(child, sizeof(child), "%s/%s", path, de->d_name);
+    if (stat(child, &st) != 0) {
+      perror(child);
+      continue;
+    }
+
+    if (n == max) {
+      fprintf(stderr, "E| %s: too many entries\n", path);
+      break;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+      const size_t count = fat16_count(child) + 2;
+      const uint16_t cluster = fat16_alloc(fs, count * 32);
+      if (!cluster)
+        goto full;
+
+      fat16_dirent(entries + 32 * n++, name, ATTR_DIRECTORY, cluster, 0);
+      const size_t capacity = ((count * 32 + SECTOR - 1) / SECTOR) * SECTOR / 32;
+      if (!fat16_dir(fs, child, fat16_cluster(fs, cluster), capacity, cluster, self))
+        goto fail;
+    } else if (S_ISREG(st.st_mode)) {
+      uint16_t cluster = 0;
+      if (st.st_size) {
+        FILE *f = fopen(child, "rb");
+        if (!f) {
+          perror(child);
+          continue;
+        }
+        cluster = fat16_alloc(fs, st.st_size);
+        if (!cluster) {
+          fclose(f);
+          goto full;
+        }
+        // Chains are contiguous, so is the file content
+        if (fread(fat16_cluster(fs, cluster), 1, st.st_size, f) != (size_t)st.st_size)
+          perror(child);
+        fclose(f);
+      }
+
+      fat16_dirent(entries + 32 * n++, name, ATTR_ARCHIVE, cluster, st.st_size);
+    }
+  }
+
+  closedir(d);
+  return 1;
+
+full:
+  fprintf(stderr, "E| %s: SD card image is full\n", path);
+fail:
+  closedir(d);
+  return 0;
+}
+
+static int fat16_build(uint8_t *image, const char *dir)
+{
+  struct fat16 fs = { image, 2 };
+  uint8_t *b = image;
+
+  // Boot sector, without partition table
+  b[0] = 0xeb; b[1] = 0x3c; b[2] = 0x90;
+  memcpy(b + 3, "MSDOS5.0", 8);
+  put16(b + 11, SECTOR);
+  b[13] = 1;                 // Sectors per cluster
+  put16(b + 14, RESERVED);
+  b[16] = FATS;
+  put16(b + 17, ROOT_ENTRIES);
+  put16(b + 19, SDCARD_SECTORS);
+  b[21] = 0xf8;              // Media descriptor
+  put16(b + 22, FAT_SECTORS);
+  put16(b + 24, 32);         // Sectors per track
+  put16(b + 26, 64);         // Heads
+  b[36] = 0x80;              // Drive number
+  b[38] = 0x29;              // Extended boot signature
+  memcpy(b + 43, "NO NAME    ", 11);
+  memcpy(b + 54, "FAT16   ", 8);
+  b[510] = 0x55; b[511] = 0xaa;
+
+  // Reserved FAT entries
+  fat16_set(&fs, 0, 0xfff8);
+  fat16_set(&fs, 1, 0xffff);
+
+  return fat16_dir(&fs, dir, image + (size_t)ROOT_START * SECTOR, ROOT_ENTRIES, 0, 0);
+}
+
+int sdcard_init(struct sdcard *sd, const char *dir)
+{
+  memset(sd, 0, sizeof(*sd));
+
+  sd->size = (size_t)SDCARD_SECTORS * SECTOR;
+  sd->image = calloc(1, sd->size);
+  if (!sd->image)
+    return 0;
+
+  return fat16_build(sd->image, dir);
+}
+
+void sdcard_free(struct sdcard *sd)
+{
+  free(sd->image);
+  sd->image = NULL;
+}
+
+void sdcard_select(struct sdcard *sd, int selected)
+{
+  sd->selected = selected;
+  sd->cmd_len = 0;
+
+  // Deselecting aborts any response in flight
+  if (!selected)
+    sd->resp_len = sd->resp_pos = 0;
+}
+
+static void sdcard_respond(struct sdcard *sd, uint8_t r1)
+{
+  sd->resp[sd->resp_len++] = 0xff; // NCR
+  sd->resp[sd->resp_len++] = r1;
+}
+
+static void sdcard_command(struct sdcard *sd)
+{
+  const uint8_t cmd = sd->cmd[0] & 0x3f;
+  const uint32_t arg = (uint32_t)sd->cmd[1] << 24 | sd->cmd[2] << 16 | sd->cmd[3] << 8 | sd->cmd[4];
+  const int app_cmd = sd->app_cmd;
+  const uint8_t idle = sd->ready ? R1_READY : R1_IDLE;
+
+  sd->resp_len = sd->resp_pos = 0;
+  sd->app_cmd = 0;
+
+  switch (cmd) {
+    case 0:  // GO_IDLE_STATE
+      sd->ready = 0;
+      sdcard_respond(sd, R1_IDLE);
+      break;
+
+    case 8:  // SEND_IF_COND, version 1 cards do not know it
+      sdcard_respond(sd, idle | R1_ILLEGAL);
+      break;
+
+    case 55: // APP_CMD
+      sd->app_cmd = 1;
+      sdcard_respond(sd, idle);
+      break;
+
+    case 41: // SD_SEND_OP_COND
+      if (!app_cmd) {
+        sdcard_respond(sd, idle | R1_ILLEGAL);
+        break;
+      }
+      sd->ready = 1;
+      sdcard_respond(sd, R1_READY);
+      break;
+
+    case 58: // READ_OCR
+      sdcard_respond(sd, idle);
+      sd->resp[sd->resp_len++] = 0x80; // Powered up, not SDHC
+      sd->resp[sd->resp_len++] = 0xff;
+      sd->resp[sd->resp_len++] = 0x80;
+      sd->resp[sd->resp_len++] = 0x00;
+      break;
+
+    case 12: // STOP_TRANSMISSION
+    case 16: // SET_BLOCKLEN
+      sdcard_respond(sd, idle);
+      break;
+
+    case 13: // SEND_STATUS
+      sdcard_respond(sd, idle);
+      sd->resp[sd->resp_len++] = 0x00;
+      break;
+
+    case 17: // READ_SINGLE_BLOCK, byte address
+      if (arg % SECTOR || arg + SECTOR > sd->size) {
+        sdcard_respond(sd, 0x40); // Parameter error
+        break;
+      }
+      sdcard_respond(sd, R1_READY);
+      sd->resp[sd->resp_len++] = 0xff;
+      sd->resp[sd->resp_len++] = TOKEN_START_BLOCK;
+      memcpy(sd->resp + sd->resp_len, sd->image + arg, SECTOR);
+      sd->resp_len += SECTOR;
+      sd->resp[sd->resp_len++] = 0xff; // CRC
+      sd->resp[sd->resp_len++] = 0xff;
+      break;
+
+    default: // Writes and everything else are not supported
+      sdcard_respond(sd, idle | R1_ILLEGAL);
+      break;
+  }
+}
+
+uint8_t sdcard_spi(struct sdcard *sd, uint8_t mosi)
+{
+  if (sd->resp_pos < sd->resp_len)
+    return sd->resp[sd->resp_pos++];
+
+  // Idle clocks between commands
+  if (sd->cmd_len == 0 && (mosi & 0xc0) != 0x40)
+    return 0xff;
+
+  sd->cmd[sd->cmd_len++] = mosi;
+  if (sd->cmd_len == sizeof(sd->cmd)) {
+    sd->cmd_len = 0;
+    sdcard_command(sd);
+  }
+
+  return 0xff;
+}
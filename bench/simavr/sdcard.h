@@ -0,0 +1,34 @@
+#ifndef _SDCARD_H
+#define _SDCARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * SPI mode model of a (version 1, byte addressed) SD card, read only
+ *
+ * The card content is a FAT16 image built in memory from a host directory,
+ * laid out the way the Arduino SD library expects (no partition table).
+ */
+
+#define SDCARD_SECTORS 8192 // 4M, just enough clusters for FAT16
+
+struct sdcard {
+  uint8_t *image;
+  size_t   size;
+  int      selected;
+  int      ready;          // ACMD41 done
+  uint8_t  cmd[6];
+  int      cmd_len;
+  int      app_cmd;        // Last command was CMD55
+  uint8_t  resp[520];
+  size_t   resp_len;
+  size_t   resp_pos;
+};
+
+int sdcard_init(struct sdcard *sd, const char *dir);
+void sdcard_free(struct sdcard *sd);
+void sdcard_select(struct sdcard *sd, int selected);
+uint8_t sdcard_spi(struct sdcard *sd, uint8_t mosi);
+
+#endif /* end of include guard: _SDCARD_H */
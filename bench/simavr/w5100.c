@@ -0,0 +1,223 @@
+#include <string.h>
+
+#include "w5100.h"
+
+// SPI opcodes
+#define OP_WRITE 0xf0
+#define OP_READ  0x0f
+
+// Common registers
+#define MR 0x0000
+
+// Socket registers (offset from socket base)
+#define SOCK_BASE(s) (0x0400 + (s) * 0x0100)
+#define Sn_MR     0x00
+#define Sn_CR     0x01
+#define Sn_IR     0x02
+#define Sn_SR     0x03
+#define Sn_PORT   0x04
+#define Sn_TX_FSR 0x20
+#define Sn_TX_WR  0x24
+#define Sn_RX_RSR 0x26
+#define Sn_RX_RD  0x28
+
+// Socket buffers
+#define TX_BASE(s) (0x4000 + (s) * W5100_BUFSIZE)
+#define RX_BASE(s) (0x6000 + (s) * W5100_BUFSIZE)
+#define BUFMASK    (W5100_BUFSIZE - 1)
+
+// Sn_MR protocols
+#define MR_TCP 0x01
+#define MR_UDP 0x02
+
+// Sn_CR commands
+#define CR_OPEN    0x01
+#define CR_LISTEN  0x02
+#define CR_CONNECT 0x04
+#define CR_DISCON  0x08
+#define CR_CLOSE   0x10
+#define CR_SEND    0x20
+#define CR_RECV    0x40
+
+// Sn_IR bits
+#define IR_SEND_OK 0x10
+
+// Sn_SR states
+#define SR_CLOSED      0x00
+#define SR_INIT        0x13
+#define SR_LISTEN      0x14
+#define SR_ESTABLISHED 0x17
+#define SR_UDP         0x22
+
+static uint16_t get16(const struct w5100 *w, uint16_t addr)
+{
+  return (uint16_t)(w->mem[addr] << 8 | w->mem[addr + 1]);
+}
+
+static void set16(struct w5100 *w, uint16_t addr, uint16_t value)
+{
+  w->mem[addr] = value >> 8;
+  w->mem[addr + 1] = value & 0xff;
+}
+
+static void w5100_reset(struct w5100 *w)
+{
+  memset(w->mem, 0, sizeof(w->mem));
+  memset(w->sock, 0, sizeof(w->sock));
+
+  // We drain TX as soon as it is sent, so it is always free
+  for (int s = 0; s < W5100_SOCKETS; s++)
+    set16(w, SOCK_BASE(s) + Sn_TX_FSR, W5100_BUFSIZE);
+}
+
+static void w5100_command(struct w5100 *w, int s, uint8_t cmd)
+{
+  const uint16_t base = SOCK_BASE(s);
+  struct w5100_socket *sock = &w->sock[s];
+
+  switch (cmd) {
+    case CR_OPEN:
+      switch (w->mem[base + Sn_MR] & 0x0f) {
+        case MR_TCP: w->mem[base + Sn_SR] = SR_INIT; break;
+        case MR_UDP: w->mem[base + Sn_SR] = SR_UDP;  break;
+        default:     w->mem[base + Sn_SR] = SR_CLOSED; break;
+      }
+      sock->rx_wr = 0;
+      sock->tx_rd = 0;
+      sock->out_len = 0;
+      sock->closed = 0;
+      set16(w, base + Sn_TX_WR, 0);
+      set16(w, base + Sn_RX_RD, 0);
+      set16(w, base + Sn_RX_RSR, 0);
+      break;
+
+    case CR_LISTEN:
+      if (w->mem[base + Sn_SR] == SR_INIT)
+        w->mem[base + Sn_SR] = SR_LISTEN;
+      break;
+
+    case CR_CONNECT:
+      // Nobody to connect to
+      w->mem[base + Sn_SR] = SR_CLOSED;
+      break;
+
+    case CR_DISCON:
+    case CR_CLOSE:
+      if (w->mem[base + Sn_SR] == SR_ESTABLISHED)
+        sock->closed = 1;
+      w->mem[base + Sn_SR] = SR_CLOSED;
+      break;
+
+    case CR_SEND: {
+      const uint16_t wr = get16(w, base + Sn_TX_WR);
+      while (sock->tx_rd != wr) {
+        const uint8_t c = w->mem[TX_BASE(s) + (sock->tx_rd & BUFMASK)];
+        if (w->mem[base + Sn_SR] == SR_ESTABLISHED && sock->out_len < W5100_OUTSIZE)
+          sock->out[sock->out_len++] = c;
+        sock->tx_rd++;
+      }
+      w->mem[base + Sn_IR] |= IR_SEND_OK;
+      break;
+    }
+
+    case CR_RECV:
+      set16(w, base + Sn_RX_RSR, sock->rx_wr - get16(w, base + Sn_RX_RD));
+      break;
+
+    default:
+      break;
+  }
+
+  // Commands complete immediately
+  w->mem[base + Sn_CR] = 0;
+}
+
+static void w5100_write(struct w5100 *w, uint16_t addr, uint8_t value)
+{
+  if (addr >= sizeof(w->mem))
+    return;
+
+  if (addr == MR) {
+    if (value & 0x80)
+      w5100_reset(w); // Soft reset, bit clears itself
+    else
+      w->mem[MR] = value;
+    return;
+  }
+
+  if (addr >= SOCK_BASE(0) && addr < SOCK_BASE(W5100_SOCKETS)) {
+    const int s = (addr - SOCK_BASE(0)) >> 8;
+    switch (addr & 0xff) {
+      case Sn_CR:
+        w5100_command(w, s, value);
+        return;
+      case Sn_IR:
+        w->mem[addr] &= ~value; // Write 1 to clear
+        return;
+      default:
+        break;
+    }
+  }
+
+  w->mem[addr] = value;
+}
+
+void w5100_init(struct w5100 *w)
+{
+  w->frame_len = 0;
+  w->selected = 0;
+  w5100_reset(w);
+}
+
+void w5100_select(struct w5100 *w, int selected)
+{
+  w->selected = selected;
+  w->frame_len = 0;
+}
+
+uint8_t w5100_spi(struct w5100 *w, uint8_t mosi)
+{
+  // Frames are <op> <addr hi> <addr lo> <data>, anything else (e.g. probes
+  // for W5200 or W5500 by the Ethernet library) reads back as zero
+  w->frame[w->frame_len++] = mosi;
+  if (w->frame_len < 4)
+    return w->frame_len - 1;
+
+  const uint16_t addr = (uint16_t)(w->frame[1] << 8 | w->frame[2]);
+  w->frame_len = 0;
+
+  switch (w->frame[0]) {
+    case OP_WRITE:
+      w5100_write(w, addr, w->frame[3]);
+      return 3;
+    case OP_READ:
+      return addr < sizeof(w->mem) ? w->mem[addr] : 0;
+    default:
+      return 0;
+  }
+}
+
+int w5100_listening(struct w5100 *w, uint16_t port)
+{
+  for (int s = 0; s < W5100_SOCKETS; s++) {
+    const uint16_t base = SOCK_BASE(s);
+    if (w->mem[base + Sn_SR] == SR_LISTEN && get16(w, base + Sn_PORT) == port)
+      return s;
+  }
+
+  return -1;
+}
+
+void w5100_inject(struct w5100 *w, int s, const void *data, size_t len)
+{
+  const uint16_t base = SOCK_BASE(s);
+  struct w5100_socket *sock = &w->sock[s];
+  const uint8_t *p = data;
+
+  w->mem[base + Sn_SR] = SR_ESTABLISHED;
+
+  for (size_t i = 0; i < len; i++)
+    w->mem[RX_BASE(s) + (sock->rx_wr++ & BUFMASK)] = p[i];
+
+  set16(w, base + Sn_RX_RSR, sock->rx_wr - get16(w, base + Sn_RX_RD));
+}
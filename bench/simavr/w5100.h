@@ -0,0 +1,43 @@
+#ifndef _W5100_H
+#define _W5100_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Register level model of the WIZnet W5100, as driven over SPI by the Arduino
+ * Ethernet library
+ *
+ * TCP connections are not simulated on the wire: a request is injected
+ * straight into the RX buffer of a listening socket, and whatever the firmware
+ * SENDs is collected until it disconnects.
+ */
+
+#define W5100_SOCKETS   4
+#define W5100_BUFSIZE   2048
+#define W5100_OUTSIZE   8192
+
+struct w5100_socket {
+  uint16_t rx_wr;              // Our write pointer into the RX buffer
+  uint16_t tx_rd;              // Our read pointer into the TX buffer
+  uint8_t  out[W5100_OUTSIZE]; // Everything sent on the connection
+  size_t   out_len;
+  int      closed;             // Connection has been closed by the firmware
+};
+
+struct w5100 {
+  uint8_t mem[0x8000];
+  uint8_t frame[4];
+  int     frame_len;
+  int     selected;
+  struct w5100_socket sock[W5100_SOCKETS];
+};
+
+void w5100_init(struct w5100 *w);
+void w5100_select(struct w5100 *w, int selected);
+uint8_t w5100_spi(struct w5100 *w, uint8_t mosi);
+
+int w5100_listening(struct w5100 *w, uint16_t port);
+void w5100_inject(struct w5100 *w, int s, const void *data, size_t len);
+
+#endif /* end of include guard: _W5100_H */
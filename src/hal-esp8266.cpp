@@ -0,0 +1,317 @@
+#ifdef ARDUINO_ARCH_ESP8266
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <ESPAsyncTCP.h>
+#include <LittleFS.h>
+
+#include "thing-def.h"
+#include "hal.h"
+
+/**
+ * Define the WiFi network to join
+ */
+#ifndef WIFI_SSID
+#define WIFI_SSID ""
+#endif
+
+#ifndef WIFI_PASSWORD
+#define WIFI_PASSWORD ""
+#endif
+
+// Number of connections served at the same time
+#ifndef HAL_CLIENTS
+#define HAL_CLIENTS 4
+#endif
+
+// Seconds of silence before an incomplete request is dropped
+#ifndef HAL_RX_TIMEOUT
+#define HAL_RX_TIMEOUT 5
+#endif
+
+// Milliseconds to wait for the peer to take our response
+#ifndef HAL_TX_TIMEOUT
+#define HAL_TX_TIMEOUT 5000
+#endif
+
+// Buffer sizes
+#define BUFSIZE_FILE_PATH 24
+#define BUFSIZE_REQUEST   1024
+#define BUFSIZE_RESPONSE  256
+
+/**
+ * One connection slot
+ *
+ * Data is collected by the async TCP callbacks until the request is complete,
+ * then the handler runs from loop() against this Stream. The response is
+ * buffered and handed over to the TCP stack chunk by chunk.
+ */
+class HalClient : public Stream {
+public:
+  enum State { FREE, RECEIVING, READY, BUSY, CLOSING };
+
+  AsyncClient *tcp = nullptr;
+  State state = FREE;
+
+  void attach(AsyncClient *c)
+  {
+    tcp = c;
+    state = RECEIVING;
+    rx_len = 0;
+    rx_pos = 0;
+    tx_len = 0;
+    rx[0] = '\0';
+  }
+
+  void detach(void)
+  {
+    tcp = nullptr;
+
+    // Keep the slot until the handler running on it returns
+    if (state != BUSY)
+      state = FREE;
+  }
+
+  void receive(const void *data, size_t len)
+  {
+    if (state != RECEIVING)
+      return;
+
+    if (len > BUFSIZE_REQUEST - 1 - rx_len)
+      len = BUFSIZE_REQUEST - 1 - rx_len;
+
+    memcpy(rx + rx_len, data, len);
+    rx_len += len;
+    rx[rx_len] = '\0';
+
+    if (complete())
+      state = READY;
+  }
+
+  void close(void)
+  {
+    flush();
+
+    if (tcp) {
+      state = CLOSING;
+      tcp->close();
+    } else {
+      state = FREE;
+    }
+  }
+
+  int available(void) override
+  {
+    return rx_len - rx_pos;
+  }
+
+  int read(void) override
+  {
+    return rx_pos < rx_len ? (unsigned char)rx[rx_pos++] : -1;
+  }
+
+  int peek(void) override
+  {
+    return rx_pos < rx_len ? (unsigned char)rx[rx_pos] : -1;
+  }
+
+  size_t write(uint8_t c) override
+  {
+    if (tx_len == BUFSIZE_RESPONSE)
+      flush();
+
+    tx[tx_len++] = c;
+    return 1;
+  }
+
+  void flush(void) override
+  {
+    size_t sent = 0;
+    const unsigned long start = millis();
+
+    // NOTE: tcp is reset if the peer goes away while we yield
+    while (sent < tx_len && tcp && tcp->connected()) {
+      if (millis() - start > HAL_TX_TIMEOUT)
+        break;
+
+      if (!tcp->canSend() || !tcp->space()) {
+        // Let the TCP stack process ACKs
+        delay(1);
+        continue;
+      }
+
+      sent += tcp->add(tx + sent, tx_len - sent, ASYNC_WRITE_FLAG_COPY);
+      tcp->send();
+    }
+
+    tx_len = 0;
+  }
+
+private:
+  char rx[BUFSIZE_REQUEST];
+  size_t rx_len = 0;
+  size_t rx_pos = 0;
+  char tx[BUFSIZE_RESPONSE];
+  size_t tx_len = 0;
+
+  // Whether the whole header and Content-Length bytes of body are in
+  bool complete(void)
+  {
+    // Full, let the handler deal with what we have
+    if (rx_len == BUFSIZE_REQUEST - 1)
+      return true;
+
+    const char *end = strstr(rx, "\r\n\r\n");
+    if (!end)
+      return false;
+
+    size_t content_length = 0;
+    for (const char *line = rx; line < end; line = strchr(line, '\n') + 1)
+      if (strncasecmp_P(line, PSTR("Content-Length:"), 15) == 0)
+        content_length = strtoul(line + 15, nullptr, 10);
+
+    return rx_len >= (size_t)(end - rx) + 4 + content_length;
+  }
+};
+
+static HalClient clients[HAL_CLIENTS];
+
+// Main TCP server
+static AsyncServer server(PORT);
+
+static void hal_on_client(void *arg, AsyncClient *tcp)
+{
+  (void)arg;
+
+  HalClient *slot = nullptr;
+  for (size_t i = 0; i < HAL_CLIENTS; i++) {
+    if (clients[i].state == HalClient::FREE) {
+      slot = &clients[i];
+      break;
+    }
+  }
+
+  if (!slot) {
+#ifdef DEBUG
+    Serial.println(F("W| hal_on_client: no free slot, dropping connection"));
+#endif
+    tcp->onDisconnect([](void *, AsyncClient *c) { delete c; }, nullptr);
+    tcp->close(true);
+    return;
+  }
+
+#ifdef DEBUG
+  Serial.println(F(">| New connection"));
+#endif
+
+  slot->attach(tcp);
+  tcp->setRxTimeout(HAL_RX_TIMEOUT);
+
+  tcp->onData([](void *arg, AsyncClient *, void *data, size_t len) {
+    static_cast<HalClient *>(arg)->receive(data, len);
+  }, slot);
+
+  tcp->onTimeout([](void *, AsyncClient *c, uint32_t) {
+    c->close(true);
+  }, slot);
+
+  tcp->onDisconnect([](void *arg, AsyncClient *c) {
+    static_cast<HalClient *>(arg)->detach();
+    delete c;
+  }, slot);
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int hal_storage_begin(void)
+{
+#ifdef DEBUG
+  Serial.println(F("I| Configuring LittleFS"));
+#endif
+
+  return LittleFS.begin();
+}
+
+hal_file_t hal_file_open_P(const char *path)
+{
+  char buffer[BUFSIZE_FILE_PATH];
+
+  strlcpy_P(buffer, path, BUFSIZE_FILE_PATH);
+  return LittleFS.open(buffer, "r");
+}
+
+void hal_network_begin(void)
+{
+  WiFi.mode(WIFI_STA);
+  WiFi.hostname(THING_NAME);
+
+#ifndef USE_DHCP
+  WiFi.config(IPAddress(NET_IP), IPAddress(NET_GATEWAY), IPAddress(NET_SUBNET), IPAddress(NET_DNS));
+#endif
+
+#ifdef DEBUG
+  Serial.print(F("I| MAC: "));
+  Serial.println(WiFi.macAddress());
+  Serial.print(F("<| Joining "));
+  Serial.println(F(WIFI_SSID));
+#endif
+
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  while (WiFi.status() != WL_CONNECTED)
+    delay(100);
+
+  server.onClient(hal_on_client, nullptr);
+  server.begin();
+}
+
+void hal_network_maintain(void)
+{
+  // DHCP lease is maintained by the SDK
+}
+
+IPAddress hal_local_ip(void)
+{
+  return WiFi.localIP();
+}
+
+void hal_serve(hal_handler_t handler)
+{
+  for (size_t i = 0; i < HAL_CLIENTS; i++) {
+    if (clients[i].state != HalClient::READY)
+      continue;
+
+    clients[i].state = HalClient::BUSY;
+    handler(clients[i]);
+
+#ifdef DEBUG
+    Serial.println(F("X| Closing connection"));
+#endif
+
+    clients[i].close();
+  }
+}
+
+int hal_udp_begin_multicast(hal_udp_t & udp, IPAddress group, uint16_t port)
+{
+  return udp.beginMulticast(WiFi.localIP(), group, port);
+}
+
+int hal_udp_begin_packet_multicast(hal_udp_t & udp, IPAddress group, uint16_t port)
+{
+  return udp.beginPacketMulticast(group, port, WiFi.localIP());
+}
+
+void hal_reboot(void)
+{
+  // Give the TCP stack a chance to deliver the last response
+  delay(100);
+  ESP.restart();
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARDUINO_ARCH_ESP8266 */
@@ -0,0 +1,147 @@
+#ifndef ARDUINO_ARCH_ESP8266
+
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <SD.h>
+
+#include <avr/wdt.h>
+
+#include "thing-def.h"
+#include "hal.h"
+
+#define BUFSIZE_FILE_PATH 24
+
+// MAC address of the Thing
+static uint8_t mac[] = {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED};
+
+// Main TCP server
+static EthernetServer server(PORT);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int hal_storage_begin(void)
+{
+#ifdef DEBUG
+  Serial.print(F("I| Configuring SD card at pin "));
+  Serial.println(SD_SS);
+#endif
+
+  return SD.begin(SD_SS);
+}
+
+hal_file_t hal_file_open_P(const char *path)
+{
+  char buffer[BUFSIZE_FILE_PATH];
+
+  strlcpy_P(buffer, path, BUFSIZE_FILE_PATH);
+  return SD.open(buffer, FILE_READ);
+}
+
+void hal_network_begin(void)
+{
+#ifdef USE_DHCP
+  Ethernet.begin(mac);
+#else
+  static const byte _ip[] = {NET_IP};
+  static const byte _dns[] = {NET_DNS};
+  static const byte _gateway[] = {NET_GATEWAY};
+  static const byte _subnet[] = {NET_SUBNET};
+  Ethernet.begin(mac, _ip, _dns, _gateway, _subnet);
+#endif
+
+#ifdef DEBUG
+  Serial.print(F("I| MAC: "));
+  Serial.print(mac[0], HEX);
+  for (int i = 1; i < 6; i++) {
+    Serial.print(F(":"));
+    Serial.print(mac[i], HEX);
+  }
+  Serial.println();
+#ifdef USE_DHCP
+  Serial.println(F("<| DHCP..."));
+#endif
+#endif
+
+  server.begin();
+}
+
+void hal_network_maintain(void)
+{
+#ifdef USE_DHCP
+  switch(Ethernet.maintain()) {
+    case 1:
+      // renew failed
+      Serial.println(F("E| DHCP IP renewal failed!"));
+      break;
+    case 2:
+      // renew success
+      Serial.println(F("I| DHCP IP renewal success"));
+      Serial.print(F("I| "));
+      Serial.println(Ethernet.localIP());
+      break;
+    case 3:
+      // rebind fail
+      Serial.println(F("E| DHCP IP rebind failed!"));
+      break;
+    case 4:
+      // rebind success
+      Serial.println(F("I| DHCP IP rebind success"));
+      Serial.print(F("I| "));
+      Serial.println(Ethernet.localIP());
+      break;
+    case 0: // fall through
+    default:
+      // nothing happened
+      break;
+  }
+#endif
+}
+
+IPAddress hal_local_ip(void)
+{
+  return Ethernet.localIP();
+}
+
+void hal_serve(hal_handler_t handler)
+{
+  // The W5100 serves one connection at a time
+  EthernetClient client = server.available();
+  if (!client)
+    return;
+
+#ifdef DEBUG
+  Serial.println(F(">| New connection"));
+#endif
+
+  handler(client);
+
+#ifdef DEBUG
+  Serial.println(F("X| Closing connection"));
+#endif
+
+  client.stop();
+}
+
+int hal_udp_begin_multicast(hal_udp_t & udp, IPAddress group, uint16_t port)
+{
+  return udp.beginMulticast(group, port);
+}
+
+int hal_udp_begin_packet_multicast(hal_udp_t & udp, IPAddress group, uint16_t port)
+{
+  return udp.beginPacket(group, port);
+}
+
+void hal_reboot(void)
+{
+  wdt_enable(WDTO_15MS);
+  for (;;) {}
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARDUINO_ARCH_ESP8266 */
@@ -0,0 +1,88 @@
+#ifndef _HAL_H
+#define _HAL_H
+
+#include <Arduino.h>
+
+#include "thing-def.h"
+
+/**
+ * Hardware abstraction layer
+ *
+ * Request handlers only see a Stream (request in, response out), files opened
+ * through hal_file_open_P() and the LED functions below. Everything else is
+ * up to the backend:
+ *
+ *   hal-w5100.cpp   -- AVR + W5100 Ethernet shield + SD card
+ *   hal-esp8266.cpp -- ESP8266 WiFi + async TCP + LittleFS
+ *
+ * bench/host/hal-host.cpp stands in for the W5100 one in host builds.
+ */
+
+#if defined(ARDUINO_ARCH_ESP8266)
+#include <FS.h>
+#include <WiFiUdp.h>
+
+typedef fs::File hal_file_t;
+typedef WiFiUDP  hal_udp_t;
+#else
+#include <Ethernet.h>
+#include <EthernetUdp.h>
+#include <SD.h>
+
+typedef File        hal_file_t;
+typedef EthernetUDP hal_udp_t;
+#endif
+
+/**
+ * Request handler, called once per connection
+ *
+ * Whether the request is complete by then is up to the backend: the ESP8266
+ * one waits for the header and Content-Length bytes of body, the W5100 one
+ * calls it as soon as anything is available. Handlers must cope with the rest
+ * of a request arriving late, or not at all, through the Stream timeout.
+ *
+ * The connection is closed by the backend after the handler returns.
+ */
+typedef void (*hal_handler_t)(Stream & client);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int hal_storage_begin(void);
+hal_file_t hal_file_open_P(const char *path);
+
+void hal_network_begin(void);
+void hal_network_maintain(void);
+IPAddress hal_local_ip(void);
+void hal_serve(hal_handler_t handler);
+
+int hal_udp_begin_multicast(hal_udp_t & udp, IPAddress group, uint16_t port);
+int hal_udp_begin_packet_multicast(hal_udp_t & udp, IPAddress group, uint16_t port);
+
+void hal_reboot(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * LED, on GPIO on every backend
+ */
+static inline void hal_led_begin(void)
+{
+  pinMode(LED_PIN, OUTPUT);
+  digitalWrite(LED_PIN, LOW);
+}
+
+static inline int hal_led_read(void)
+{
+  return digitalRead(LED_PIN) == HIGH;
+}
+
+static inline void hal_led_write(int on)
+{
+  digitalWrite(LED_PIN, on ? HIGH : LOW);
+}
+
+#endif /* end of include guard: _HAL_H */
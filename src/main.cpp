@@ -1,17 +1,16 @@
 #include <Arduino.h>
-#include <Ethernet.h>
-#include <SD.h>
 #include <stdint.h>
 
-#ifdef USE_MDNS
-#include <ArduinoMDNS.h>
-#endif
-
 #include "thing-def.h"
 #include "html_headers.h"
+#include "hal.h"
 #include "thing-op.h"
 #include "utils.h"
 
+#ifdef USE_MDNS
+#include "mdns.h"
+#endif
+
 // DEBUG information include _DEBUG's
 #ifdef DEBUG
 #define _DEBUG
@@ -23,11 +22,6 @@
 #endif
 #endif
 
-// Port number that the server listens on
-#ifndef PORT
-#define PORT 80
-#endif
-
 // Buffer sizes
 #define BUFSIZE_METHOD       7
 #define BUFSIZE_METHOD_SCANF "6"
@@ -35,17 +29,7 @@
 #define BUFSIZE_PATH_SCANF   "74"
 #define BUFSIZE_LINE         81
 #define BUFSIZE_LINE_SCANF   "80"
-
-#ifdef USE_MDNS
-EthernetUDP udp; // UDP class used by mDNS
-MDNS mdns(udp);  // MDNS class
-#endif
-
-// MAC address of the Thing
-static uint8_t mac[] = {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED};
-
-// Main TCP server
-EthernetServer server(PORT);
+#define BUFSIZE_FORMAT       12
 
 void setup(void)
 {
@@ -57,53 +41,24 @@ void setup(void)
 #endif
 
   // Pin init
-  pinMode(LED_PIN, OUTPUT);
-  digitalWrite(LED_PIN, LOW);
+  hal_led_begin();
 
-#ifdef DEBUG
-  Serial.print(F("I| Configuring SD card at pin "));
-  Serial.println(SD_SS);
-#endif
-
-  // SD Card Init
-  if (!SD.begin(SD_SS)) {
+  // Storage Init
+  if (!hal_storage_begin()) {
 #ifdef _DEBUG
-    Serial.println(F("W| SD card init fail! Halting..."));
+    Serial.println(F("W| Storage init fail! Halting..."));
 #endif
     // What can I do?
     for (;;) {}
   }
 
 #ifdef DEBUG
-  Serial.println(F("I| SD card init succeed"));
+  Serial.println(F("I| Storage init succeed"));
   Serial.println(F("I| Configuring network..."));
 #endif
 
-#ifdef USE_DHCP
-  Ethernet.begin(mac);
-#else
-  static const byte _ip[] = {192, 168, 1, 141};
-  static const byte _dns[] = {192, 168, 1, 1};
-  static const byte _gateway[] = {192, 168, 1, 1};
-  static const byte _subnet[] = {255, 255, 255, 0};
-  Ethernet.begin(mac, _ip, _dns, _gateway, _subnet);
-#endif
-
-#ifdef DEBUG
-  Serial.print(F("I| MAC: "));
-  Serial.print(mac[0], HEX);
-  for (int i = 1; i < 6; i++) {
-    Serial.print(F(":"));
-    Serial.print(mac[i], HEX);
-  }
-  Serial.println();
-#ifdef USE_DHCP
-  Serial.println(F("<| DHCP..."));
-#endif
-#endif
-
-  server.begin();
-  IPAddress ip = Ethernet.localIP();
+  hal_network_begin();
+  IPAddress ip = hal_local_ip();
 
 #ifdef DEBUG
 #ifdef USE_DHCP
@@ -117,13 +72,7 @@ void setup(void)
 #endif
 
 #ifdef USE_MDNS
-  mdns.begin(ip, THING_NAME);
-
-#ifdef DEBUG
-  Serial.println(F("I| Registering mDNS service record..."));
-#endif
-
-  mdns.addServiceRecord(THING_DESCRIPTION "._http", PORT, MDNSServiceTCP);
+  mdns_begin();
 #endif
 
 #ifdef _DEBUG
@@ -141,24 +90,8 @@ void setup(void)
 #endif
 }
 
-void loop(void)
+static void handle_request(Stream & client)
 {
-#ifdef USE_MDNS
-  mdns.run();
-#endif
-
-#ifdef USE_DHCP
-  ethernet_maintain();
-#endif
-
-  EthernetClient client = server.available();
-  if (!client)
-    return;
-
-#ifdef DEBUG
-  Serial.println(F(">| New connection"));
-#endif
-
   // For return value checking
   int r = 0;
 
@@ -170,12 +103,13 @@ void loop(void)
 
   // Read the first line of request to obtain HTTP method and path
   // <METHOD> <PATH> <HTTP_VERSION>
+  // NOTE: Not every core has sscanf_P (ESP8266 does not), so the format is
+  // copied out of flash first
+  char format[BUFSIZE_FORMAT];
+  strlcpy_P(format, PSTR("%" BUFSIZE_METHOD_SCANF "s %" BUFSIZE_PATH_SCANF "s"), BUFSIZE_FORMAT);
+
   http_read_line(linebuf, BUFSIZE_LINE, client);
-  r = sscanf_P(
-    linebuf,
-    PSTR("%" BUFSIZE_METHOD_SCANF "s %" BUFSIZE_PATH_SCANF "s"),
-    method, path
-  );
+  r = sscanf(linebuf, format, method, path);
   if (r != 2) {
     // And since we know insufficient information, we can only stop here
 #ifdef DEBUG
@@ -183,7 +117,6 @@ void loop(void)
     Serial.println(r);
     Serial.println(F("X| Can do nothing, closing connection"));
 #endif
-    client.stop();
     // free(linebuf);
     // free(path);
     // free(method);
@@ -208,36 +141,43 @@ void loop(void)
   // Check path to determine what to do next
   if (strcasecmp_P(path, PSTR("/")) == 0) {
     // '/' -> Device portal page
-    // thing_resp_portal_page(server, method);
-    thing_resp_thing(server, method);
+    // thing_resp_portal_page(client, method);
+    thing_resp_thing(client, method);
   } else if (strcasecmp_P(path, PSTR("/things")) == 0) {
     // '/things' -> Things resource (3.5)
-    thing_resp_things(server, method);
+    thing_resp_things(client, method);
   } else if (strcasecmp_P(path, PSTR("/things/" THING_NAME)) == 0) {
     // '/things/<name>' -> Thing resource (3.1)
-    thing_resp_thing(server, method);
+    thing_resp_thing(client, method);
   } else if (strncasecmp_P(path, PSTR("/things/" THING_NAME "/properties"), strlen_P(PSTR("/things/" THING_NAME "/properties"))) == 0) {
     // '/things/<name>/properties(/...)' -> This does not make sense (3.2)
     // Sub APIs processed in the function
     // NOTE: PUT is only supported in properties
-    thing_proceed_properties(server, client, method, path);
+    thing_proceed_properties(client, method, path);
   } else if (strncasecmp_P(path, PSTR("/things/" THING_NAME "/actions"), strlen_P(PSTR("/things/" THING_NAME "/actions"))) == 0) {
     // '/things/<name>/actions(/...)' -> Actions resource (3.3)
     // Sub APIs processed in the function
     // NOTE: POST is only supported in actions
-    thing_proceed_actions(server, client, method, path);
+    thing_proceed_actions(client, method, path);
   } else if (strncasecmp_P(path, PSTR("/things/" THING_NAME "/events"), strlen_P(PSTR("/things/" THING_NAME "/events")) )== 0) {
     // '/things/<name>/events(/...)' -> Events resource (3.4)
     // Sub APIs processed in the function
-    thing_proceed_events(server, client, method, path);
+    thing_proceed_events(client, method, path);
   } else {
     // No such path
-    thing_resp_not_found(server, method);
+    thing_resp_not_found(client, method);
   }
+}
 
-#ifdef DEBUG
-  Serial.println(F("X| Closing connection"));
+void loop(void)
+{
+#ifdef USE_MDNS
+  mdns_run();
 #endif
 
-  client.stop();
+  hal_network_maintain();
+  hal_serve(handle_request);
+
+  if (thing_reboot_pending)
+    hal_reboot();
 }
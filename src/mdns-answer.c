@@ -0,0 +1,190 @@
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "thing-def.h"
+#include "mdns.h"
+
+#ifdef USE_MDNS
+
+// NOTE: This file is C on purpose: C lets a char array be initialized with a
+// string literal of the exact same length (dropping the NUL), which is what a
+// DNS label is. C++ does not allow this.
+
+// Length of a string literal, without NUL
+#define LEN(s) (sizeof(s) - 1)
+
+// Big-endian encoding of 16-bit and 32-bit numbers
+#define U16(x) { (uint8_t)((x) >> 8), (uint8_t)(x) }
+#define U32(x) { (uint8_t)((x) >> 24), (uint8_t)((x) >> 16), (uint8_t)((x) >> 8), (uint8_t)(x) }
+
+// DNS name compression pointer to a field of the answer packet
+#define NAME_PTR(field) U16(0xc000 | offsetof(struct mdns_answer_packet, field))
+
+// Resource record types
+#define TYPE_A   1
+#define TYPE_PTR 12
+#define TYPE_TXT 16
+#define TYPE_SRV 33
+
+// Resource record classes (IN, with and without the mDNS cache-flush bit)
+#define CLASS_SHARED 0x0001
+#define CLASS_UNIQUE 0x8001
+
+// TTLs recommended by RFC 6762 section 10
+#define TTL_HOST  120
+#define TTL_OTHER 4500
+
+// Resource record header following the owner name
+struct mdns_rr {
+  uint8_t type[2];
+  uint8_t klass[2];
+  uint8_t ttl[4];
+  uint8_t rdlength[2];
+};
+
+#define RR(t, c, ttl, rdlength) { U16(t), U16(c), U32(ttl), U16(rdlength) }
+
+#define INSTANCE  THING_DESCRIPTION
+#define TXT_PATH  "path=/things/" THING_NAME
+
+// DNS labels are at most 63 bytes long, TXT strings 255
+_Static_assert(LEN(THING_NAME) <= 63, "THING_NAME is too long for a DNS label");
+_Static_assert(LEN(INSTANCE) <= 63, "THING_DESCRIPTION is too long for a DNS label");
+_Static_assert(LEN(TXT_PATH) <= 255, "THING_NAME is too long for a TXT record");
+
+struct mdns_answer_packet {
+  // Header
+  uint8_t id[2];
+  uint8_t flags[2];
+  uint8_t qdcount[2];
+  uint8_t ancount[2];
+  uint8_t nscount[2];
+  uint8_t arcount[2];
+
+  // _http._tcp.local PTR <INSTANCE>._http._tcp.local
+  uint8_t http_len;
+  char    http[LEN("_http")];
+  uint8_t tcp_len;
+  char    tcp[LEN("_tcp")];
+  uint8_t local_len;
+  char    local[LEN("local")];
+  uint8_t root;
+  struct mdns_rr http_ptr;
+  uint8_t http_instance_len;
+  char    http_instance[LEN(INSTANCE)];
+  uint8_t http_instance_ptr[2];
+
+  // _webthing._tcp.local PTR <INSTANCE>._webthing._tcp.local
+  uint8_t webthing_len;
+  char    webthing[LEN("_webthing")];
+  uint8_t webthing_ptr[2];
+  struct mdns_rr webthing_ptr_rr;
+  uint8_t webthing_instance_len;
+  char    webthing_instance[LEN(INSTANCE)];
+  uint8_t webthing_instance_ptr[2];
+
+  // <INSTANCE>._http._tcp.local SRV 0 0 <PORT> <THING_NAME>.local
+  uint8_t http_srv_name[2];
+  struct mdns_rr http_srv;
+  uint8_t http_srv_priority[2];
+  uint8_t http_srv_weight[2];
+  uint8_t http_srv_port[2];
+  uint8_t host_len;
+  char    host[LEN(THING_NAME)];
+  uint8_t host_ptr[2];
+
+  // <INSTANCE>._http._tcp.local TXT "path=/things/<THING_NAME>"
+  uint8_t http_txt_name[2];
+  struct mdns_rr http_txt;
+  uint8_t http_txt_len;
+  char    http_txt_path[LEN(TXT_PATH)];
+
+  // <INSTANCE>._webthing._tcp.local SRV 0 0 <PORT> <THING_NAME>.local
+  uint8_t webthing_srv_name[2];
+  struct mdns_rr webthing_srv;
+  uint8_t webthing_srv_priority[2];
+  uint8_t webthing_srv_weight[2];
+  uint8_t webthing_srv_port[2];
+  uint8_t webthing_srv_target[2];
+
+  // <INSTANCE>._webthing._tcp.local TXT "path=/things/<THING_NAME>"
+  uint8_t webthing_txt_name[2];
+  struct mdns_rr webthing_txt;
+  uint8_t webthing_txt_len;
+  char    webthing_txt_path[LEN(TXT_PATH)];
+
+  // <THING_NAME>.local A <IP> (IP must be the last field, see mdns.h)
+  uint8_t a_name[2];
+  struct mdns_rr a;
+  uint8_t a_ip[MDNS_ANSWER_IP_SIZE];
+};
+
+static const struct mdns_answer_packet answer PROGMEM = {
+  .id      = U16(0),
+  .flags   = U16(0x8400), // Response, Authoritative Answer
+  .qdcount = U16(0),
+  .ancount = U16(7),
+  .nscount = U16(0),
+  .arcount = U16(0),
+
+  .http_len          = LEN("_http"),
+  .http              = "_http",
+  .tcp_len           = LEN("_tcp"),
+  .tcp               = "_tcp",
+  .local_len         = LEN("local"),
+  .local             = "local",
+  .root              = 0,
+  .http_ptr          = RR(TYPE_PTR, CLASS_SHARED, TTL_OTHER, 1 + LEN(INSTANCE) + 2),
+  .http_instance_len = LEN(INSTANCE),
+  .http_instance     = INSTANCE,
+  .http_instance_ptr = NAME_PTR(http_len),
+
+  .webthing_len          = LEN("_webthing"),
+  .webthing              = "_webthing",
+  .webthing_ptr          = NAME_PTR(tcp_len),
+  .webthing_ptr_rr       = RR(TYPE_PTR, CLASS_SHARED, TTL_OTHER, 1 + LEN(INSTANCE) + 2),
+  .webthing_instance_len = LEN(INSTANCE),
+  .webthing_instance     = INSTANCE,
+  .webthing_instance_ptr = NAME_PTR(webthing_len),
+
+  .http_srv_name     = NAME_PTR(http_instance_len),
+  .http_srv          = RR(TYPE_SRV, CLASS_UNIQUE, TTL_HOST, 6 + 1 + LEN(THING_NAME) + 2),
+  .http_srv_priority = U16(0),
+  .http_srv_weight   = U16(0),
+  .http_srv_port     = U16(PORT),
+  .host_len          = LEN(THING_NAME),
+  .host              = THING_NAME,
+  .host_ptr          = NAME_PTR(local_len),
+
+  .http_txt_name = NAME_PTR(http_instance_len),
+  .http_txt      = RR(TYPE_TXT, CLASS_UNIQUE, TTL_OTHER, 1 + LEN(TXT_PATH)),
+  .http_txt_len  = LEN(TXT_PATH),
+  .http_txt_path = TXT_PATH,
+
+  .webthing_srv_name     = NAME_PTR(webthing_instance_len),
+  .webthing_srv          = RR(TYPE_SRV, CLASS_UNIQUE, TTL_HOST, 6 + 2),
+  .webthing_srv_priority = U16(0),
+  .webthing_srv_weight   = U16(0),
+  .webthing_srv_port     = U16(PORT),
+  .webthing_srv_target   = NAME_PTR(host_len),
+
+  .webthing_txt_name = NAME_PTR(webthing_instance_len),
+  .webthing_txt      = RR(TYPE_TXT, CLASS_UNIQUE, TTL_OTHER, 1 + LEN(TXT_PATH)),
+  .webthing_txt_len  = LEN(TXT_PATH),
+  .webthing_txt_path = TXT_PATH,
+
+  .a_name = NAME_PTR(host_len),
+  .a      = RR(TYPE_A, CLASS_UNIQUE, TTL_HOST, MDNS_ANSWER_IP_SIZE),
+  .a_ip   = {0, 0, 0, 0},
+};
+
+_Static_assert(
+  offsetof(struct mdns_answer_packet, a_ip) + MDNS_ANSWER_IP_SIZE == sizeof(struct mdns_answer_packet),
+  "IP address must be at the end of the mDNS answer packet"
+);
+
+const uint8_t *const mdns_answer = (const uint8_t *)&answer;
+const size_t mdns_answer_size = sizeof(answer);
+
+#endif /* USE_MDNS */
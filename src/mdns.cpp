@@ -0,0 +1,224 @@
+#include <Arduino.h>
+
+#include "thing-def.h"
+#include "hal.h"
+#include "mdns.h"
+
+#ifdef USE_MDNS
+
+#define MDNS_PORT        5353
+#define MDNS_HEADER_SIZE 12
+#define MDNS_BUFSIZE     16
+
+// Questions are buffered so that compressed names can be followed back into
+// earlier ones; anything beyond is ignored
+#define MDNS_QUESTIONS_SIZE 96
+#define MDNS_MAX_POINTERS   8
+
+// A record is not multicast again within a second (RFC 6762 section 6); every
+// answer carries all of our records, so this goes for the whole packet
+#define MDNS_MIN_INTERVAL 1000
+
+// UDP socket joined to the mDNS multicast group
+static hal_udp_t udp;
+
+// millis() when the last answer was sent
+static unsigned long mdns_last_sent = 0;
+
+// Names we answer for, in dotted form (compared case-insensitively)
+static const char mdns_name_host[] PROGMEM          = THING_NAME ".local";
+static const char mdns_name_http[] PROGMEM          = "_http._tcp.local";
+static const char mdns_name_webthing[] PROGMEM      = "_webthing._tcp.local";
+static const char mdns_name_http_inst[] PROGMEM     = THING_DESCRIPTION "._http._tcp.local";
+static const char mdns_name_webthing_inst[] PROGMEM = THING_DESCRIPTION "._webthing._tcp.local";
+
+static const char *const mdns_names[] PROGMEM = {
+  mdns_name_host,
+  mdns_name_http,
+  mdns_name_webthing,
+  mdns_name_http_inst,
+  mdns_name_webthing_inst,
+};
+
+#define MDNS_NAMES (sizeof(mdns_names) / sizeof(mdns_names[0]))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Compare character c at position pos against every still matching name,
+ * dropping the ones that differ
+ */
+static uint8_t mdns_match(uint8_t candidates, const uint8_t pos, const char c)
+{
+  for (uint8_t i = 0; i < MDNS_NAMES; i++) {
+    if (!(candidates & (1 << i)))
+      continue;
+
+    const char *name = (const char *)pgm_read_ptr(&mdns_names[i]);
+    const char expected = pgm_read_byte(name + pos);
+    if (expected == '\0' || tolower(expected) != tolower(c))
+      candidates &= ~(1 << i);
+  }
+
+  return candidates;
+}
+
+/**
+ * Match the DNS name at *offset in the question section against our names
+ *
+ * Compression pointers are followed, as long as they point backwards into
+ * what has been buffered. Returns non-zero if the name is one of ours, and
+ * moves *offset past the name, or to 0 if the name cannot be read.
+ */
+static uint8_t mdns_read_name(const uint8_t *questions, const uint8_t size, uint8_t *offset)
+{
+  uint8_t candidates = (1 << MDNS_NAMES) - 1;
+  uint8_t pos = 0;
+  uint8_t i = *offset;
+  uint8_t end = 0; // Where the name ends in the section, known at the first pointer
+  uint8_t pointers = 0;
+
+  *offset = 0;
+
+  for (;;) {
+    if (i >= size)
+      return 0;
+
+    const uint8_t len = questions[i];
+    if (len == 0)
+      break;
+
+    if ((len & 0xc0) == 0xc0) {
+      if (i + 1 >= size)
+        return 0;
+
+      // Offsets are from the start of the packet, header included
+      const uint16_t target = (((uint16_t)(len & 0x3f) << 8) | questions[i + 1]);
+      if (target < MDNS_HEADER_SIZE || target - MDNS_HEADER_SIZE >= i || ++pointers > MDNS_MAX_POINTERS)
+        return 0;
+
+      if (!end)
+        end = i + 2;
+      i = target - MDNS_HEADER_SIZE;
+      continue;
+    }
+
+    // Other label types are not a thing in mDNS
+    if ((len & 0xc0) || i + 1 + len > size)
+      return 0;
+
+    if (pos && candidates)
+      candidates = mdns_match(candidates, pos++, '.');
+    for (uint8_t k = 0; k < len && candidates; k++)
+      candidates = mdns_match(candidates, pos++, questions[i + 1 + k]);
+
+    i += 1 + len;
+  }
+
+  *offset = end ? end : i + 1;
+
+  // The whole name must have been matched
+  for (uint8_t n = 0; n < MDNS_NAMES; n++) {
+    const char *name = (const char *)pgm_read_ptr(&mdns_names[n]);
+    if ((candidates & (1 << n)) && pgm_read_byte(name + pos) != '\0')
+      candidates &= ~(1 << n);
+  }
+
+  return candidates;
+}
+
+void mdns_begin(void)
+{
+#ifdef DEBUG
+  Serial.println(F("I| mdns_begin: joining multicast group"));
+#endif
+
+  hal_udp_begin_multicast(udp, IPAddress(224, 0, 0, 251), MDNS_PORT);
+  mdns_announce();
+}
+
+void mdns_run(void)
+{
+  // Nothing pending costs us a single check (one register read on the W5100)
+  if (!udp.parsePacket())
+    return;
+
+  uint8_t header[MDNS_HEADER_SIZE];
+  if (udp.read(header, MDNS_HEADER_SIZE) != MDNS_HEADER_SIZE)
+    return;
+
+  // Only standard queries (QR = 0, OPCODE = 0), ignore responses
+  if (header[2] & 0xf8)
+    return;
+
+  uint8_t questions[MDNS_QUESTIONS_SIZE];
+  const int size = udp.read(questions, MDNS_QUESTIONS_SIZE);
+  if (size <= 0)
+    return;
+
+  uint16_t qdcount = ((uint16_t)header[4] << 8) | header[5];
+  uint8_t offset = 0;
+  while (qdcount--) {
+    if (mdns_read_name(questions, size, &offset)) {
+#ifdef DEBUG
+      Serial.println(F(">| mdns_run: query for us"));
+#endif
+      if (millis() - mdns_last_sent < MDNS_MIN_INTERVAL) {
+#ifdef DEBUG
+        Serial.println(F("W| mdns_run: answered less than a second ago, skipping"));
+#endif
+        return;
+      }
+
+      // Whatever is asked, the answer packet covers all of it
+      mdns_announce();
+      return;
+    }
+
+    // Unreadable, or past what we buffered
+    if (!offset)
+      return;
+
+    // Skip QTYPE and QCLASS
+    offset += 4;
+  }
+
+  // Remaining of the packet is discarded by the next parsePacket()
+}
+
+void mdns_announce(void)
+{
+  uint8_t buffer[MDNS_BUFSIZE];
+  const size_t size = mdns_answer_size - MDNS_ANSWER_IP_SIZE;
+
+  if (!hal_udp_begin_packet_multicast(udp, IPAddress(224, 0, 0, 251), MDNS_PORT))
+    return;
+
+  // Precomputed part of the packet, straight from flash
+  for (size_t i = 0; i < size; i += MDNS_BUFSIZE) {
+    const size_t n = size - i < MDNS_BUFSIZE ? size - i : MDNS_BUFSIZE;
+    memcpy_P(buffer, mdns_answer + i, n);
+    udp.write(buffer, n);
+  }
+
+  // Patch in the IP address, which may have changed due to DHCP
+  IPAddress ip = hal_local_ip();
+  for (uint8_t i = 0; i < MDNS_ANSWER_IP_SIZE; i++)
+    buffer[i] = ip[i];
+  udp.write(buffer, MDNS_ANSWER_IP_SIZE);
+
+  udp.endPacket();
+  mdns_last_sent = millis();
+
+#ifdef DEBUG
+  Serial.println(F("<| mdns_announce: sent answer"));
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USE_MDNS */
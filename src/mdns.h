@@ -0,0 +1,32 @@
+#ifndef _MDNS_H
+#define _MDNS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Precomputed mDNS answer packet (in PROGMEM)
+ *
+ * Carries every record we ever answer with: PTR, SRV and TXT for both
+ * _http._tcp and _webthing._tcp, and the A record of THING_NAME.local. The
+ * last MDNS_ANSWER_IP_SIZE bytes are the A record data, which is left zeroed
+ * and has to be patched with the current IP address when sending.
+ */
+extern const uint8_t *const mdns_answer;
+extern const size_t mdns_answer_size;
+
+#define MDNS_ANSWER_IP_SIZE 4
+
+void mdns_begin(void);
+void mdns_run(void);
+void mdns_announce(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: _MDNS_H */
@@ -17,6 +17,32 @@
 #define THING_DESCRIPTION "A WoT Thing"
 #endif
 
+/**
+ * Define the port number that the server listens on
+ */
+#ifndef PORT
+#define PORT 80
+#endif
+
+/**
+ * Define the network configuration used when USE_DHCP is not defined
+ */
+#ifndef NET_IP
+#define NET_IP 192, 168, 1, 141
+#endif
+
+#ifndef NET_DNS
+#define NET_DNS 192, 168, 1, 1
+#endif
+
+#ifndef NET_GATEWAY
+#define NET_GATEWAY 192, 168, 1, 1
+#endif
+
+#ifndef NET_SUBNET
+#define NET_SUBNET 255, 255, 255, 0
+#endif
+
 /**
  * Define the SS pin of the SD card (which stores static contents)
  */
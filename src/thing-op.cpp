@@ -1,11 +1,8 @@
 #include <Arduino.h>
-#include <Ethernet.h>
-#include <SD.h>
 #include <ArduinoJson.h>
 
-#include <avr/wdt.h>
-
 #include "thing-def.h"
+#include "hal.h"
 #include "thing-op.h"
 #include "html_headers.h"
 #include "utils.h"
@@ -15,23 +12,21 @@ extern "C" {
 #define restrict __restrict__ // C++ do not have standard restrict keyword as in C99
 #endif
 
-void thing_reboot(void) {
-  wdt_enable(WDTO_15MS);
-  for (;;) {}
-}
+// Set by the reboot action, acted on once the connection is closed
+bool thing_reboot_pending = false;
 
-void thing_resp_portal_page(EthernetServer & server, const char *restrict method)
+void thing_resp_portal_page(Stream & client, const char *restrict method)
 {
   if (!(strcasecmp_P(method, PSTR("GET")) == 0)) {
 #ifdef DEBUG
     Serial.println(F("W| thing_resp_portal_page: unsupported method"));
     Serial.println(F("<| thing_resp_portal_page: send 405 back"));
 #endif
-    server_println_P(server, html_header_405);
+    client_println_P(client, html_header_405);
     return;
   }
 
-  File f = SD.open(F("/index.htm"), FILE_READ);
+  hal_file_t f = hal_file_open_P(PSTR("/INDEX.HTM"));
   if (!f) {
 #ifdef DEBUG
     Serial.println(F("E| thing_resp_portal_page: failed to open index.htm"));
@@ -43,10 +38,10 @@ void thing_resp_portal_page(EthernetServer & server, const char *restrict method
   Serial.println(F("<| thing_resp_portal_page: sending index.htm"));
 #endif
 
-  server_println_P(server, html_header_200);
-  server_println_P(server, html_header_content_html);
+  client_println_P(client, html_header_200);
+  client_println_P(client, html_header_content_html);
   while (f.available())
-    server.write(f.read());
+    client.write(f.read());
 
 #ifdef DEBUG
   Serial.println(F("<| thing_resp_portal_page: sent index.htm"));
@@ -55,18 +50,18 @@ void thing_resp_portal_page(EthernetServer & server, const char *restrict method
   f.close();
 }
 
-void thing_resp_things(EthernetServer & server, const char *restrict method)
+void thing_resp_things(Stream & client, const char *restrict method)
 {
   if (!(strcasecmp_P(method, PSTR("GET")) == 0)) {
 #ifdef DEBUG
     Serial.println(F("W| thing_resp_things: unsupported method"));
     Serial.println(F("<| thing_resp_things: send 405 back"));
 #endif
-    server_println_P(server, html_header_405);
+    client_println_P(client, html_header_405);
     return;
   }
 
-  File f = SD.open(F("/thing.jsn"), FILE_READ);
+  hal_file_t f = hal_file_open_P(PSTR("/THING.JSN"));
   if (!f) {
 #ifdef DEBUG
     Serial.println(F("E| thing_resp_things: failed to open thing.jsn"));
@@ -78,12 +73,12 @@ void thing_resp_things(EthernetServer & server, const char *restrict method)
     Serial.println(F("<| thing_resp_things: sending thing.jsn"));
 #endif
 
-  server_println_P(server, html_header_200);
-  server_println_P(server, html_header_content_json);
-  server.println('[');
+  client_println_P(client, html_header_200);
+  client_println_P(client, html_header_content_json);
+  client.println('[');
   while (f.available())
-    server.write(f.read());
-  server.println(']');
+    client.write(f.read());
+  client.println(']');
 
 #ifdef DEBUG
     Serial.println(F("<| thing_resp_things: sent thing.jsn"));
@@ -92,18 +87,18 @@ void thing_resp_things(EthernetServer & server, const char *restrict method)
   f.close();
 }
 
-void thing_resp_thing(EthernetServer & server, const char *restrict method)
+void thing_resp_thing(Stream & client, const char *restrict method)
 {
   if (!(strcasecmp_P(method, PSTR("GET")) == 0)) {
 #ifdef DEBUG
     Serial.println(F("W| thing_resp_thing: unsupported method"));
     Serial.println(F("<| thing_resp_thing: send 405 back"));
 #endif
-    server_println_P(server, html_header_405);
+    client_println_P(client, html_header_405);
     return;
   }
 
-  File f = SD.open(F("/thing.jsn"), FILE_READ);
+  hal_file_t f = hal_file_open_P(PSTR("/THING.JSN"));
   if (!f) {
 #ifdef DEBUG
     Serial.println(F("E| thing_resp_thing: failed to open thing.jsn"));
@@ -115,10 +110,10 @@ void thing_resp_thing(EthernetServer & server, const char *restrict method)
     Serial.println(F("<| thing_resp_thing: sending thing.jsn"));
 #endif
 
-  server_println_P(server, html_header_200);
-  server_println_P(server, html_header_content_json);
+  client_println_P(client, html_header_200);
+  client_println_P(client, html_header_content_json);
   while (f.available())
-    server.write(f.read());
+    client.write(f.read());
 
 #ifdef DEBUG
     Serial.println(F("<| thing_resp_thing: sent thing.jsn"));
@@ -127,7 +122,7 @@ void thing_resp_thing(EthernetServer & server, const char *restrict method)
   f.close();
 }
 
-void thing_proceed_properties(EthernetServer & server, EthernetClient & client, const char *restrict method, const char *path)
+void thing_proceed_properties(Stream & client, const char *restrict method, const char *path)
 {
   // Shrink the URL to the rest of property ('/' is prefixed)
   const char *p_property_url = path + strlen_P(PSTR("/things/" THING_NAME "/properties"));
@@ -136,13 +131,13 @@ void thing_proceed_properties(EthernetServer & server, EthernetClient & client,
   // NOTE: IMPLEMENTATION STARTS HERE
   if (strcasecmp_P(p_property_url, PSTR("/on")) == 0) { // Property "on"
     if (strcasecmp_P(method, PSTR("GET")) == 0) { // Getting property detail
-      File f = SD.open(F("/property/on.jsn"), FILE_READ);
+      hal_file_t f = hal_file_open_P(PSTR("/PROPERTY/ON.JSN"));
       if (!f) {
 #ifdef DEBUG
         Serial.println(F("W| thing_proceed_properties: on.jsn not found"));
         Serial.println(F("<| thing_proceed_properties: send 500 back"));
 #endif
-        server_println_P(server, html_header_500);
+        client_println_P(client, html_header_500);
         return;
       }
 
@@ -154,18 +149,18 @@ void thing_proceed_properties(EthernetServer & server, EthernetClient & client,
         Serial.println(F("W| thing_proceed_properties: on.jsn parsing error"));
         Serial.println(F("<| thing_proceed_properties: send 500 back"));
 #endif
-        server_println_P(server, html_header_500);
+        client_println_P(client, html_header_500);
         return;
       }
 
       // Alter JSON according to status first
-      j_on["on"] = (bool)digitalRead(LED_PIN);
+      j_on["on"] = (bool)hal_led_read();
 
       // Send it back
-      server_println_P(server, html_header_200);
-      server_println_P(server, html_header_content_json);
-      j_on.printTo(server);
-      server.println();
+      client_println_P(client, html_header_200);
+      client_println_P(client, html_header_content_json);
+      j_on.printTo(client);
+      client.println();
 
     } else if (strcasecmp_P(method, PSTR("PUT")) == 0) { // Altering property detail
       JsonObject & j_on = json_buffer.parseObject(client);
@@ -174,7 +169,7 @@ void thing_proceed_properties(EthernetServer & server, EthernetClient & client,
         Serial.println(F("W| thing_proceed_properties: request JSON parsing error"));
         Serial.println(F("<| thing_proceed_properties: send 500 back"));
 #endif
-        server_println_P(server, html_header_500);
+        client_println_P(client, html_header_500);
         return;
       }
 
@@ -184,31 +179,31 @@ void thing_proceed_properties(EthernetServer & server, EthernetClient & client,
         Serial.println(F("W| thing_proceed_properties: corrupted JSON"));
         Serial.println(F("<| thing_proceed_properties: send 400 back"));
 #endif
-        server_println_P(server, html_header_400);
+        client_println_P(client, html_header_400);
         return;
       }
 
       // Apply requested properties
-      digitalWrite(LED_PIN, j_on["on"]);
+      hal_led_write(j_on["on"].as<bool>());
 
       // Send 200 back
-      server_println_P(server, html_header_200);
-      server.println();
+      client_println_P(client, html_header_200);
+      client.println();
 
     } else { // Unsupported method
 #ifdef DEBUG
       Serial.println(F("W| thing_proceed_properties: unsupported method"));
       Serial.println(F("<| thing_proceed_properties: send 405 back"));
 #endif
-      server_println_P(server, html_header_405);
+      client_println_P(client, html_header_405);
       return;
     }
   } else { // Unknown property
-    thing_resp_not_found(server, method);
+    thing_resp_not_found(client, method);
   }
 }
 
-void thing_proceed_actions(EthernetServer & server, EthernetClient & client, const char *restrict method, const char *path)
+void thing_proceed_actions(Stream & client, const char *restrict method, const char *path)
 {
   // Shrink the URL to the rest of property ('/' is prefixed)
   const char *p_action_url = path + strlen_P(PSTR("/things/" THING_NAME "/actions"));
@@ -218,7 +213,7 @@ void thing_proceed_actions(EthernetServer & server, EthernetClient & client, con
   if (strcasecmp_P(p_action_url, PSTR("/")) == 0 || strcasecmp_P(p_action_url, PSTR("")) == 0) {
     if (strcasecmp_P(method, PSTR("GET")) == 0) { // Get a list of actions
       // NOTE: I don't want to implement this here
-      server_println_P(server, html_header_204);
+      client_println_P(client, html_header_204);
 
     } else if (strcasecmp_P(method, PSTR("POST")) == 0) { // Action request
       JsonObject & j_reboot = json_buffer.parseObject(client);
@@ -227,7 +222,7 @@ void thing_proceed_actions(EthernetServer & server, EthernetClient & client, con
         Serial.println(F("W| thing_proceed_actions: request JSON parsing error"));
         Serial.println(F("<| thing_proceed_actions: send 500 back"));
 #endif
-        server_println_P(server, html_header_500);
+        client_println_P(client, html_header_500);
         return;
       }
 
@@ -237,33 +232,31 @@ void thing_proceed_actions(EthernetServer & server, EthernetClient & client, con
         Serial.println(F("W| thing_proceed_actions: corrupted JSON"));
         Serial.println(F("<| thing_proceed_actions: send 400 back"));
 #endif
-        server_println_P(server, html_header_400);
+        client_println_P(client, html_header_400);
         return;
       }
 
+      // NULL if "name" is not a string
       const char *action_name = j_reboot["name"];
 
-      if (strcmp_P(action_name, PSTR("reboot")) == 0) { // Reboot
+      if (action_name && strcmp_P(action_name, PSTR("reboot")) == 0) { // Reboot
         // First send acknowledgement
         // TODO: XXX: I can't be bothered to generate a UUID here
-        server_println_P(server, html_header_204);
-
-        // Close connection
-        client.stop();
+        client_println_P(client, html_header_204);
 
 #ifdef DEBUG
         Serial.println(F("I| System is going down!"));
 #endif
 
-        thing_reboot();
-        // NOTE: THIS LINE NEVER REACHED.
+        // Reboot after the connection is closed
+        thing_reboot_pending = true;
 
       } else { // Unknown name of action
 #ifdef DEBUG
         Serial.println(F("W| thing_proceed_actions: unknown action name"));
         Serial.println(F("<| thing_proceed_actions: send 400 back"));
 #endif
-        server_println_P(server, html_header_400);
+        client_println_P(client, html_header_400);
       }
 
     } else { // Unsupported method
@@ -271,21 +264,21 @@ void thing_proceed_actions(EthernetServer & server, EthernetClient & client, con
       Serial.println(F("W| thing_proceed_actions: unsupported method"));
       Serial.println(F("<| thing_proceed_actions: send 405 back"));
 #endif
-      server_println_P(server, html_header_405);
+      client_println_P(client, html_header_405);
     }
   } else { // Action operation
     //
   }
 }
 
-void thing_proceed_events(EthernetServer & server, EthernetClient & client, const char *restrict method, const char *path)
+void thing_proceed_events(Stream & client, const char *restrict method, const char *path)
 {
   if (!(strcasecmp_P(method, PSTR("GET")) == 0)) {
 #ifdef DEBUG
     Serial.println(F("W| thing_proceed_events: unsupported method"));
     Serial.println(F("<| thing_proceed_events: send 405 back"));
 #endif
-    server_println_P(server, html_header_405);
+    client_println_P(client, html_header_405);
     return;
   }
 
@@ -295,7 +288,7 @@ void thing_proceed_events(EthernetServer & server, EthernetClient & client, cons
   // NOTE: IMPLEMENTATION STARTS HERE
 }
 
-void thing_resp_not_found(EthernetServer & server, const char *restrict method)
+void thing_resp_not_found(Stream & client, const char *restrict method)
 {
   // I don't care whatever method it is
 
@@ -303,8 +296,8 @@ void thing_resp_not_found(EthernetServer & server, const char *restrict method)
   Serial.println(F("<| thing_resp_not_found: send 404 back"));
 #endif
 
-  server_println_P(server, html_header_404);
-  server.println();
+  client_println_P(client, html_header_404);
+  client.println();
 
 #ifdef DEBUG
   Serial.println(F("<| thing_resp_not_found: sent 404 header"));
@@ -2,20 +2,21 @@
 #define _THING_OP_H
 
 #include <Arduino.h>
-#include <Ethernet.h>
 
 #ifdef __cplusplus
 extern "C" {
 #define restrict __restrict__ // C++ do not have standard restrict keyword as in C99
 #endif
 
-void thing_resp_portal_page(EthernetServer & server, const char *restrict method);
-void thing_resp_things(EthernetServer & server, const char *restrict method);
-void thing_resp_thing(EthernetServer & server, const char *restrict method);
-void thing_proceed_properties(EthernetServer & server, EthernetClient & client, const char *restrict method, const char *path);
-void thing_proceed_actions(EthernetServer & server, EthernetClient & client, const char *restrict method, const char *path);
-void thing_proceed_events(EthernetServer & server, EthernetClient & client, const char *restrict method, const char *path);
-void thing_resp_not_found(EthernetServer & server, const char *restrict method);
+extern bool thing_reboot_pending;
+
+void thing_resp_portal_page(Stream & client, const char *restrict method);
+void thing_resp_things(Stream & client, const char *restrict method);
+void thing_resp_thing(Stream & client, const char *restrict method);
+void thing_proceed_properties(Stream & client, const char *restrict method, const char *path);
+void thing_proceed_actions(Stream & client, const char *restrict method, const char *path);
+void thing_proceed_events(Stream & client, const char *restrict method, const char *path);
+void thing_resp_not_found(Stream & client, const char *restrict method);
 
 #ifdef __cplusplus
 }
@@ -1,5 +1,4 @@
 #include <Arduino.h>
-#include <Ethernet.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -7,7 +6,7 @@ extern "C" {
 
 #define BUFSIZE_LINE 64
 
-int http_read_line(char *buffer, const size_t size, EthernetClient & client)
+int http_read_line(char *buffer, const size_t size, Stream & client)
 {
   if (!buffer || !size)
     return 0;
@@ -15,9 +14,17 @@ int http_read_line(char *buffer, const size_t size, EthernetClient & client)
   char c = '\0';
   char *p_buffer = buffer;
   size_t counter = 0; // Prevent buffer overflow
+  bool timeout = false;
+
+  // NOTE: readBytes() rather than available() + read(): a line split across
+  // TCP segments is not all there yet, readBytes() waits up to the Stream
+  // timeout for each byte
+  while (counter < size - 1) {
+    if (client.readBytes(&c, 1) != 1) {
+      timeout = true;
+      break;
+    }
 
-  while (client.connected() && client.available() && counter < size - 1) {
-    c = client.read();
     if (c != '\r' && c != '\n') {
       *p_buffer++ = c;
       ++counter;
@@ -34,72 +41,46 @@ int http_read_line(char *buffer, const size_t size, EthernetClient & client)
   Serial.print(F(">| http_read_line: '"));
   Serial.print(buffer);
   Serial.println(F("'"));
+  if (timeout)
+    Serial.println(F("W| http_read_line: timed out"));
 #endif
 
-  // Then we need to move the cursor to the next line
-  while ((c = client.read()) && c != '\n') {}
+  // Then we need to move the cursor to the next line, waiting at most the
+  // Stream timeout for it in case the rest of the line is yet to come
+  if (!timeout && c != '\n')
+    client.find((char *)"\n");
 
   return 1;
 }
 
-void server_println_P(EthernetServer & server, const char *str)
+void client_println_P(Print & client, const char *str)
 {
   static char buffer[BUFSIZE_LINE] = {0};
   size_t chunks = strlen_P(str) > BUFSIZE_LINE ? strlen_P(str) / BUFSIZE_LINE : 1;
 
 #ifdef DEBUG
-  Serial.print(F("I| server_println_P: "));
+  Serial.print(F("I| client_println_P: "));
   Serial.print(chunks);
   Serial.println(F(" chunk(s) to be sent"));
 #endif
 
   for (size_t i = 0; i < chunks; i++) {
 #ifdef DEBUG
-    Serial.print(F("<| server_println_P: Chunk "));
+    Serial.print(F("<| client_println_P: Chunk "));
     Serial.println(i);
 #endif
     strlcpy_P(buffer, str, BUFSIZE_LINE);
-    server.println(buffer);
+    client.println(buffer);
   }
 
 #ifdef DEBUG
-  Serial.println(F("I| server_println_P: Data sent"));
+  Serial.println(F("I| client_println_P: Data sent"));
 #endif
 
   // Don't forget to free the buffer
   // free(buffer);
 }
 
-void ethernet_maintain(void)
-{
-  switch(Ethernet.maintain()) {
-    case 1:
-      // renew failed
-      Serial.println(F("E| DHCP IP renewal failed!"));
-      break;
-    case 2:
-      // renew success
-      Serial.println(F("I| DHCP IP renewal success"));
-      Serial.print(F("I| "));
-      Serial.println(Ethernet.localIP());
-      break;
-    case 3:
-      // rebind fail
-      Serial.println(F("E| DHCP IP rebind failed!"));
-      break;
-    case 4:
-      // rebind success
-      Serial.println(F("I| DHCP IP rebind success"));
-      Serial.print(F("I| "));
-      Serial.println(Ethernet.localIP());
-      break;
-    case 0: // fall through
-    default:
-      // nothing happened
-      break;
-  }
-}
-
 #ifdef __cplusplus
 }
 #endif
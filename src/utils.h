@@ -5,9 +5,8 @@
 extern "C" {
 #endif
 
-int http_read_line(char *buffer, const size_t size, EthernetClient & client);
-void server_println_P(EthernetServer & server, const char *str);
-void ethernet_maintain(void);
+int http_read_line(char *buffer, const size_t size, Stream & client);
+void client_println_P(Print & client, const char *str);
 
 #ifdef __cplusplus
 }